@@ -1,6 +1,10 @@
 #pragma once
 
 #include "math.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
 namespace swarm
 {
 #define SWARM_HANDLE(object) \
@@ -11,7 +15,19 @@ using object##Handle = object##_T*;
     using SwarmAllocFn = void* (*)(unsigned int size);
     using SwarmFreeFn = void (*)(void *ptr);
 
+    // Host memory hooks for the library, the Vulkan driver and the memory allocator.
+    // reallocFn gets a live block and a non zero size, it may move the block and must keep the requested alignment.
+    struct SwarmAllocationCallbacks
+    {
+        void *userData{nullptr};
+        void *(*allocFn)(void *userData, size_t size, size_t alignment){nullptr};
+        void *(*reallocFn)(void *userData, void *ptr, size_t size, size_t alignment){nullptr};
+        void (*freeFn)(void *userData, void *ptr){nullptr};
+    };
+
+    // The size only hooks are used for the library's own objects, the driver keeps its default allocator
     bool InitSwarm(SwarmAllocFn allocFn = nullptr, SwarmFreeFn freeFn = nullptr);
+    bool InitSwarm(const SwarmAllocationCallbacks &allocationCallbacks);
     void ShutdownSwarm();
 
     SWARM_HANDLE(Instance);
@@ -23,14 +39,19 @@ using object##Handle = object##_T*;
     SWARM_HANDLE(Framebuffer);
     SWARM_HANDLE(Shader);
     SWARM_HANDLE(DescriptorSetlayout);
+    SWARM_HANDLE(DescriptorPool);
+    SWARM_HANDLE(DescriptorSet);
     SWARM_HANDLE(Pipeline);
     SWARM_HANDLE(CommandPool);
     SWARM_HANDLE(CommandBuffer);
     SWARM_HANDLE(Semaphore); //GPU
     SWARM_HANDLE(Fence); //CPU
+    SWARM_HANDLE(Timeline); //GPU and CPU, monotonically increasing counter
     SWARM_HANDLE(Buffer);
     SWARM_HANDLE(Texture);
     SWARM_HANDLE(Sampler);
+    SWARM_HANDLE(TransientAllocator);
+    SWARM_HANDLE(FrameManager);
 
     //============================ Instance ============================
 
@@ -39,6 +60,7 @@ using object##Handle = object##_T*;
         const char *applicationName{nullptr};
         unsigned int applicationVersion{0};
         bool isDebug{false};
+        bool isHeadless{false}; //No window system extensions, pass a null surface to CreateDevice
     };
     InstanceHandle CreateInstance(const InstanceCreateInfo &instanceCreateInfo);
     void DestroyInstance(InstanceHandle &handle);
@@ -79,14 +101,125 @@ using object##Handle = object##_T*;
     struct DeviceCreateInfo
     {
         bool isDiscreteGPURequired{false};
+
+        // Size of the persistent staging ring used to upload into GPU_ONLY buffers.
+        // Uploads larger than the ring fall back to a temporary staging buffer, 0 disables the ring.
+        unsigned int stagingBufferSize{16 * 1024 * 1024};
+
+        // GPU_ONLY buffers are carved out of shared blocks of this size.
+        // Buffers bigger than a quarter of a block get their own memory, 0 disables suballocation.
+        unsigned int bufferBlockSize{64 * 1024 * 1024};
+
+        // Destroy calls hand the object to a queue instead of freeing it, it is released once the GPU retired the
+        // next submission made on each queue after the call, so commands recorded before it are still covered.
+        // The queue is collected by CmdBeginFrame and CollectDestroyedObjects, and emptied by DestroyDevice.
+        bool deferredDestruction{false};
+
+        // Run uploads on a transfer queue family of their own, dedicated if the device has one, so streaming
+        // overlaps rendering. Buffers and textures are then shared by both families. Falls back to the graphics queue.
+        bool useTransferQueue{false};
+
+        // Give QueueType::COMPUTE a queue family of its own so compute work runs alongside rendering.
+        // Without one, or if the device has none, compute is submitted to the graphics queue.
+        bool useAsyncComputeQueue{false};
+
+        // Blob previously returned by GetPipelineCacheData, usually read back from disk.
+        // It is ignored when its header doesn't match the vendor, device and pipeline cache UUID of the selected GPU.
+        const void *pipelineCacheData{nullptr};
+        size_t pipelineCacheSize{0};
+
+        // Threads compiling CreatePipelineAsync and CreatePipelines requests, started on the first one.
+        // 0 uses one less than the number of hardware threads.
+        unsigned int pipelineWorkerCount{0};
+
+        // Give every sampled texture, sampler and storage buffer a slot in one device-wide descriptor set, see
+        // GetBindlessIndex. Descriptor indexing becomes a requirement, devices without it are not selected.
+        bool enableBindless{false};
+        unsigned int bindlessTextureCount{16384}; //Slots per array, clamped to the device limits
+        unsigned int bindlessSamplerCount{256};
+        unsigned int bindlessBufferCount{16384};
+    };
+
+    enum class QueueType
+    {
+        GRAPHICS, COMPUTE
+    };
+
+    // Captured once by CreateDevice, querying it never goes back to the driver
+    struct DeviceCapabilities
+    {
+        char deviceName[256]{};
+        uint32_t vendorID{0};
+        uint32_t deviceID{0};
+        uint32_t apiVersion{0};
+        bool isDiscreteGPU{false};
+
+        // Limits
+        uint32_t maxImageDimension2D{0};
+        uint32_t maxImageArrayLayers{0};
+        uint32_t maxUniformBufferRange{0};
+        uint32_t maxStorageBufferRange{0};
+        uint32_t maxPushConstantsSize{0};
+        uint32_t maxBoundDescriptorSets{0};
+        uint32_t maxPushDescriptors{0}; //0 without DeviceCapabilities::pushDescriptors
+        uint32_t maxVertexInputAttributes{0};
+        uint32_t maxVertexInputBindings{0};
+        uint32_t maxColorAttachments{0};
+        uint32_t maxComputeWorkGroupCount[3]{};
+        uint32_t maxComputeWorkGroupSize[3]{};
+        uint32_t maxComputeWorkGroupInvocations{0};
+        uint64_t minUniformBufferOffsetAlignment{0};
+        uint64_t minStorageBufferOffsetAlignment{0};
+        float maxSamplerAnisotropy{1.0f};
+        float timestampPeriod{0.0f}; //Nanoseconds per timestamp tick
+
+        // Features
+        bool samplerAnisotropy{false};
+        bool multiDrawIndirect{false};
+        bool drawIndirectFirstInstance{false};
+        bool textureCompressionBC{false};
+        bool extendedDynamicState{false}; //PipelineCreateInfo::useDynamicState is honored
+        bool dynamicBlendEnable{false}; //CmdSetBlendEnable is available
+        bool bindless{false}; //The heap of DeviceCreateInfo::enableBindless exists
+        bool pushDescriptors{false}; //CreatePushDescriptorSetlayout and CmdPushDescriptorSet are available
+
+        // Memory
+        uint64_t deviceLocalMemorySize{0};
+        bool hasHostVisibleDeviceLocalMemory{false}; //e.g. resizable BAR, the CPU can write straight to VRAM
+
+        // Queues actually in use, see DeviceCreateInfo
+        bool hasTransferQueue{false};
+        bool hasAsyncComputeQueue{false};
     };
 
+    struct PipelineCacheStats
+    {
+        bool isSeeded{false}; //The blob given to CreateDevice was accepted
+        bool hasCreationFeedback{false}; //Without driver feedback every creation is counted as unknown
+
+        uint32_t hits{0};
+        uint32_t misses{0};
+        uint32_t unknown{0};
+        uint64_t creationTime{0}; //Nanoseconds spent creating the pipelines with feedback
+    };
+
+    // surface may be nullptr, the device then only renders offscreen
     DeviceHandle CreateDevice(InstanceHandle instance, SurfaceHandle surface, const DeviceCreateInfo& deviceCreateInfo);
     void DestroyDevice(DeviceHandle &handle);
 
 
     void WaitDeviceIdle(DeviceHandle handle);
 
+    const DeviceCapabilities& GetDeviceCapabilities(DeviceHandle device);
+
+    // Serializes the pipeline cache so it can be saved to disk and given back to CreateDevice.
+    // With a null `data` returns the size to allocate, otherwise the bytes written, 0 if `size` is too small.
+    size_t GetPipelineCacheData(DeviceHandle device, void *data, size_t size);
+    PipelineCacheStats GetPipelineCacheStats(DeviceHandle device);
+
+    // Releases the objects destroyed in deferred mode that the GPU no longer uses, never blocks
+    void CollectDestroyedObjects(DeviceHandle device);
+
     //============================ Swapchain ============================
 
     struct SwapchainCreateInfo
@@ -102,10 +235,27 @@ using object##Handle = object##_T*;
 
     //============================ Renderpass ============================
 
-    struct RenderpassCreateInfo
+    enum class TextureFormat
     {
+        // Color formats
+        RGBA8_UNORM,
+        RGBA8_SRGB,
 
+        // HDR formats
+        RGBA16_SFLOAT,
+
+        // Depth formats
+        D32_SFLOAT,
     };
+
+    // Formats are only used by offscreen renderpasses, a swapchain renderpass takes the swapchain and device formats
+    struct RenderpassCreateInfo
+    {
+        TextureFormat colorFormat{TextureFormat::RGBA8_UNORM};
+        TextureFormat depthFormat{TextureFormat::D32_SFLOAT};
+    };
+
+    // swapchain may be nullptr for an offscreen renderpass, its color and depth targets are left ready for ReadTexture
     RenderpassHandle CreateRenderpass(DeviceHandle device, SwapchainHandle swapchain, const RenderpassCreateInfo &renderpassCreateInfo);
     void DestroyRenderpass(DeviceHandle device, RenderpassHandle &handle);
 
@@ -128,12 +278,14 @@ using object##Handle = object##_T*;
     //============================ Framebuffer ============================
 
     FramebufferHandle CreateFramebuffer(DeviceHandle device, SwapchainHandle swapchain, RenderpassHandle renderpass, TextureHandle depthTexture);
+    // Single framebuffer over textures created with the COLOR_ATTACHMENT and DEPTH_STENCIL_ATTACHMENT usages
+    FramebufferHandle CreateOffscreenFramebuffer(DeviceHandle device, RenderpassHandle renderpass, TextureHandle colorTexture, TextureHandle depthTexture);
     void DestroyFramebuffer(DeviceHandle device, FramebufferHandle &handle);
     //============================ Shader ============================
 
     enum class ShaderStage
     {
-        VERTEX, FRAGMENT
+        VERTEX, FRAGMENT, COMPUTE
     };
 
     struct ShaderCreateInfo
@@ -148,13 +300,14 @@ using object##Handle = object##_T*;
     //============================ DescriptorSetLayout ============================
     enum class BindingType
     {
-        UBO, IMAGE_SAMPLER
+        UBO, UBO_DYNAMIC, IMAGE_SAMPLER, STORAGE,
+        STORAGE_DYNAMIC, SAMPLED_IMAGE, SAMPLER, STORAGE_IMAGE
     };
 
     struct DescriptorSetLayoutBinding
     {
         unsigned int position;
-        unsigned int count;
+        unsigned int count; //Array size, 0 is treated as 1
         BindingType type;
         ShaderStage stage;
     };
@@ -163,6 +316,96 @@ using object##Handle = object##_T*;
     DescriptorSetlayoutHandle CreateDescriptorSetlayout(DeviceHandle device, DescriptorSetLayoutBinding* bindings, unsigned int bindingCount);
     void DestroyDescriptorSetlayout(DeviceHandle device, DescriptorSetlayoutHandle &handle);
 
+    // Layout whose descriptors are written straight into the command buffer by CmdPushDescriptorSet, no set is ever
+    // allocated for it. Only meant for PipelineCreateInfo::pushDescriptorLayout, nullptr without
+    // DeviceCapabilities::pushDescriptors, past maxPushDescriptors or with a UBO_DYNAMIC or STORAGE_DYNAMIC binding.
+    DescriptorSetlayoutHandle CreatePushDescriptorSetlayout(DeviceHandle device, DescriptorSetLayoutBinding* bindings,
+                                                            unsigned int bindingCount);
+
+    //============================ Descriptor sets ============================
+    // Sets are never freed one by one, the whole pool is reset at once. A pool that runs out of space grows by another
+    // block of the same size. Attach a pool to CmdBeginFrameInfo to have it reset once the frame fence has signaled.
+    struct DescriptorPoolCreateInfo
+    {
+        // The pool is sized for `setsPerLayout` sets of each of these layouts
+        const DescriptorSetlayoutHandle* layouts{nullptr};
+        unsigned int layoutCount{0};
+        unsigned int setsPerLayout{64};
+    };
+
+    DescriptorPoolHandle CreateDescriptorPool(DeviceHandle device, const DescriptorPoolCreateInfo& createInfo);
+    void DestroyDescriptorPool(DeviceHandle device, DescriptorPoolHandle& handle);
+
+    // Invalidates every set allocated from the pool, the GPU must be done with them
+    void ResetDescriptorPool(DeviceHandle device, DescriptorPoolHandle pool);
+
+    // One set per layout in a single call, false if any allocation failed (no set is then returned)
+    bool AllocateDescriptorSets(DeviceHandle device, DescriptorPoolHandle pool, const DescriptorSetlayoutHandle* layouts,
+                                unsigned int count, DescriptorSetHandle* sets);
+
+    struct DescriptorBufferInfo
+    {
+        BufferHandle buffer{nullptr};
+        unsigned int offset{0};
+        unsigned int range{0}; //0 = up to the end of the buffer, clamped to the device limit. Required for dynamic types
+    };
+
+    struct DescriptorImageInfo
+    {
+        TextureHandle texture{nullptr}; //Unused by SAMPLER bindings
+        SamplerHandle sampler{nullptr}; //IMAGE_SAMPLER and SAMPLER bindings only
+    };
+
+    // Writes `count` consecutive array elements of a binding, the binding type picks buffers or images.
+    // The layout the set was allocated with must still be alive.
+    struct DescriptorWrite
+    {
+        DescriptorSetHandle set{nullptr};
+        unsigned int binding{0};
+        unsigned int arrayElement{0};
+        unsigned int count{1};
+
+        const DescriptorBufferInfo* buffers{nullptr};
+        const DescriptorImageInfo* images{nullptr};
+    };
+
+    // All writes reach the driver in one vkUpdateDescriptorSets call
+    void UpdateDescriptorSets(DeviceHandle device, const DescriptorWrite* writes, unsigned int writeCount);
+
+    // Returns a set of `layout` holding exactly `writes` (their `set` is ignored), only written the first time a
+    // combination is seen. The set stays valid until a buffer, texture or sampler it references or the layout is
+    // destroyed, it must not be updated.
+    DescriptorSetHandle GetCachedDescriptorSet(DeviceHandle device, DescriptorSetlayoutHandle layout,
+                                               const DescriptorWrite* writes, unsigned int writeCount);
+
+    struct DescriptorSetCacheStats
+    {
+        // Cumulative over the device lifetime, per-draw lookups would wrap 32 bits within hours
+        uint64_t hits{0};
+        uint64_t misses{0};
+        uint64_t evictions{0}; //Sets dropped because a resource they reference was destroyed
+        uint32_t setCount{0}; //Sets currently cached, all layouts together
+    };
+
+    DescriptorSetCacheStats GetDescriptorSetCacheStats(DeviceHandle device);
+
+    //============================ Bindless ============================
+    // With DeviceCreateInfo::enableBindless, sampled textures, samplers and storage buffers are written to a device-wide
+    // set on creation: binding 0 holds textures, 1 samplers and 2 storage buffers, as runtime arrays shaders index with
+    // these values. An index is only reused once the GPU is done with the resource destroyed before.
+    constexpr uint32_t INVALID_BINDLESS_INDEX = ~0u;
+
+    // INVALID_BINDLESS_INDEX when bindless is off, the resource usage doesn't qualify or the array is full.
+    // Buffers larger than DeviceCapabilities::maxStorageBufferRange only expose that many leading bytes.
+    uint32_t GetBindlessIndex(TextureHandle texture);
+    uint32_t GetBindlessIndex(SamplerHandle sampler);
+    uint32_t GetBindlessIndex(BufferHandle buffer);
+
+    // Owned by the device, nullptr when bindless is off. The layout is only meant for PipelineCreateInfo,
+    // sets can't be allocated with it.
+    DescriptorSetlayoutHandle GetBindlessDescriptorSetlayout(DeviceHandle device);
+    DescriptorSetHandle GetBindlessDescriptorSet(DeviceHandle device);
+
 
     //============================ Vertex Specification ============================
     // Flexible vertex layout system that allows users to define custom vertex formats
@@ -184,20 +427,38 @@ using object##Handle = object##_T*;
     {
         FLOAT, VEC2, VEC3, VEC4,
         INT, IVEC2, IVEC3, IVEC4,
-        UINT, UVEC2, UVEC3, UVEC4
+        UINT, UVEC2, UVEC3, UVEC4,
+
+        // Packed formats, read as floats by the shader. SNORM maps to [-1, 1] and UNORM to [0, 1].
+        HALF2, HALF4,
+        SNORM8X4, UNORM8X4,
+        SNORM16X2, SNORM16X4, UNORM16X2,
+        SNORM_A2B10G10R10, UNORM_A2B10G10R10 // x, y and z in 10 bits each, w in 2, e.g. normals and tangents
     };
 
+    // Size in bytes of one attribute of `type`
+    unsigned int GetVertexAttributeSize(VertexAttributeType type);
+
     struct VertexAttribute
     {
         unsigned int location;
         VertexAttributeType type;
-        unsigned int offset;
+        unsigned int offset; //Relative to the start of an element of `binding`
+        unsigned int binding{0};
     };
 
+    enum class VertexInputRate
+    {
+        VERTEX,   // Advances once per vertex
+        INSTANCE, // Advances once per instance, e.g. per instance transforms
+    };
+
+    // One vertex buffer stream, streams can be split so that depth only passes read positions alone
     struct VertexBinding
     {
         unsigned int binding;
         unsigned int stride;
+        VertexInputRate inputRate{VertexInputRate::VERTEX};
     };
 
     struct VertexSpecification
@@ -260,11 +521,128 @@ using object##Handle = object##_T*;
             };
             return {&binding, 1, attributes, 4};
         }
+
+        // Per vertex position in binding 0 and a per instance model matrix in binding 1, one column per location
+        // struct { Vec3 position; } and struct { Mat4 model; }
+        inline VertexSpecification Position3DInstanceTransform()
+        {
+            static VertexBinding bindings[] = {
+                {0, sizeof(float) * 3, VertexInputRate::VERTEX},
+                {1, sizeof(float) * 16, VertexInputRate::INSTANCE}
+            };
+            static VertexAttribute attributes[] = {
+                {0, VertexAttributeType::VEC3, 0, 0},                    // position
+                {1, VertexAttributeType::VEC4, 0, 1},                    // model column 0
+                {2, VertexAttributeType::VEC4, sizeof(float) * 4, 1},    // model column 1
+                {3, VertexAttributeType::VEC4, sizeof(float) * 8, 1},    // model column 2
+                {4, VertexAttributeType::VEC4, sizeof(float) * 12, 1}    // model column 3
+            };
+            return {bindings, 2, attributes, 5};
+        }
+
+        // Packed counterpart of Position3DNormal3DTexCoordColor4 (24 bytes per vertex), fill it with EncodeVertices
+        // struct { Vec3 position; uint32 normal; half2 texCoord; uint8 color[4]; }
+        inline VertexSpecification Position3DNormal3DTexCoordColor4Packed()
+        {
+            static VertexBinding binding = {0, sizeof(float) * 3 + 12};
+            static VertexAttribute attributes[] = {
+                {0, VertexAttributeType::VEC3, 0},                                // position
+                {1, VertexAttributeType::SNORM_A2B10G10R10, sizeof(float) * 3},   // normal
+                {2, VertexAttributeType::HALF2, sizeof(float) * 3 + 4},           // texcoord
+                {3, VertexAttributeType::UNORM8X4, sizeof(float) * 3 + 8}         // color
+            };
+            return {&binding, 1, attributes, 4};
+        }
     }
 
+    // Converts `vertexCount` vertices laid out as `source` into the layout of `packed`, attributes are matched by location.
+    // Source attributes must be FLOAT to VEC4, packed ones any float readable type. Both specifications use a single
+    // binding. Values are clamped to the range of the packed type and rounded to nearest. Returns false on a mismatch.
+    bool EncodeVertices(const VertexSpecification &source, const void *sourceData,
+                        const VertexSpecification &packed, void *packedData, size_t vertexCount);
+
 
     //============================ Pipeline ============================
 
+    enum class PrimitiveTopology
+    {
+        TRIANGLE_LIST,
+        TRIANGLE_STRIP,
+        LINE_LIST,
+        LINE_STRIP,
+        POINT_LIST,
+    };
+
+    enum class CullMode
+    {
+        NONE,
+        FRONT,
+        BACK,
+        FRONT_AND_BACK,
+    };
+
+    enum class FrontFace
+    {
+        COUNTER_CLOCKWISE,
+        CLOCKWISE,
+    };
+
+    enum class CompareOp
+    {
+        NEVER,
+        LESS,
+        EQUAL,
+        LESS_OR_EQUAL,
+        GREATER,
+        NOT_EQUAL,
+        GREATER_OR_EQUAL,
+        ALWAYS,
+    };
+
+    enum class BlendFactor
+    {
+        ZERO,
+        ONE,
+        SRC_COLOR,
+        ONE_MINUS_SRC_COLOR,
+        DST_COLOR,
+        ONE_MINUS_DST_COLOR,
+        SRC_ALPHA,
+        ONE_MINUS_SRC_ALPHA,
+        DST_ALPHA,
+        ONE_MINUS_DST_ALPHA,
+    };
+
+    enum class BlendOp
+    {
+        ADD,
+        SUBTRACT,
+        REVERSE_SUBTRACT,
+        MIN,
+        MAX,
+    };
+
+    // Applied to the color attachment, defaults to standard alpha blending once enabled
+    struct BlendState
+    {
+        bool isEnabled{false};
+        BlendFactor srcColorFactor{BlendFactor::SRC_ALPHA};
+        BlendFactor dstColorFactor{BlendFactor::ONE_MINUS_SRC_ALPHA};
+        BlendOp colorOp{BlendOp::ADD};
+        BlendFactor srcAlphaFactor{BlendFactor::ONE};
+        BlendFactor dstAlphaFactor{BlendFactor::ZERO};
+        BlendOp alphaOp{BlendOp::ADD};
+    };
+
+    // Byte range of the push constant block a stage reads, offset and size are multiples of 4.
+    // Stages sharing bytes each declare a range over them.
+    struct PushConstantRange
+    {
+        ShaderStage stage{ShaderStage::VERTEX};
+        unsigned int offset{0};
+        unsigned int size{0};
+    };
+
     struct PipelineCreateInfo
     {
         ShaderHandle vertexShader;
@@ -272,8 +650,50 @@ using object##Handle = object##_T*;
         RenderpassHandle renderpass;
         DescriptorSetlayoutHandle descriptoSetLayout;
         VertexSpecification vertexSpec;
+
+        PrimitiveTopology topology{PrimitiveTopology::TRIANGLE_LIST};
+        CullMode cullMode{CullMode::BACK};
+        FrontFace frontFace{FrontFace::COUNTER_CLOCKWISE};
+
+        bool depthTestEnable{true};
+        bool depthWriteEnable{true};
+        CompareOp depthCompareOp{CompareOp::LESS};
+
+        BlendState blend{};
+
+        // Cull mode, front face, topology and depth state come from the CmdSet* calls instead of the fields above,
+        // so one pipeline covers every combination. The topology still fixes the class (points, lines or triangles).
+        // Blend enable becomes dynamic too when DeviceCapabilities::dynamicBlendEnable is set.
+        // Ignored when the device lacks DeviceCapabilities::extendedDynamicState.
+        bool useDynamicState{false};
+
+        // Per-draw data set with CmdPushConstants and CmdPushDescriptorSet instead of allocated sets
+        const PushConstantRange* pushConstantRanges{nullptr};
+        unsigned int pushConstantRangeCount{0};
+        DescriptorSetlayoutHandle pushDescriptorLayout{nullptr}; //Set 1, or set 0 without descriptoSetLayout
     };
+    // Create infos with the same shaders, renderpass, layout and vertex input return the same pipeline.
+    // Every call takes a reference, DestroyPipeline releases one and the pipeline goes with the last.
     PipelineHandle CreatePipeline(DeviceHandle device, const PipelineCreateInfo &pipelineCreateInfo);
+
+    // Compiles on the device worker threads through the shared pipeline cache, the future holds nullptr on failure.
+    // The shaders, renderpass, layout and vertex specification arrays must stay alive until the future is ready.
+    std::future<PipelineHandle> CreatePipelineAsync(DeviceHandle device, const PipelineCreateInfo &pipelineCreateInfo);
+
+    // Compiles `count` pipelines concurrently and waits for all of them, false if any entry of `pipelines` is nullptr
+    bool CreatePipelines(DeviceHandle device, const PipelineCreateInfo *createInfos, size_t count, PipelineHandle *pipelines);
+
+    struct ComputePipelineCreateInfo
+    {
+        ShaderHandle computeShader{nullptr};
+        DescriptorSetlayoutHandle descriptorSetLayout{nullptr}; //Optional
+
+        const PushConstantRange* pushConstantRanges{nullptr};
+        unsigned int pushConstantRangeCount{0};
+        DescriptorSetlayoutHandle pushDescriptorLayout{nullptr}; //Set 1, or set 0 without descriptorSetLayout
+    };
+    PipelineHandle CreateComputePipeline(DeviceHandle device, const ComputePipelineCreateInfo &pipelineCreateInfo);
+
     void DestroyPipeline(DeviceHandle device, PipelineHandle &handle);
 
 
@@ -281,7 +701,8 @@ using object##Handle = object##_T*;
 
     //============================ CommandPool ============================
 
-    CommandPoolHandle CreateCommandPool(DeviceHandle device);
+    // Command buffers of the pool can only be submitted to `queue`
+    CommandPoolHandle CreateCommandPool(DeviceHandle device, QueueType queue = QueueType::GRAPHICS);
     void DestroyCommandPool(DeviceHandle device, CommandPoolHandle &handle);
 
     //============================ CommandBuffer ============================
@@ -298,6 +719,20 @@ using object##Handle = object##_T*;
     void DestroySemaphore(DeviceHandle device, SemaphoreHandle &handle);
     void DestroyFence(DeviceHandle device, FenceHandle &handle);
 
+    // Timeline semaphore: submissions and the host signal increasing values, anyone can wait for a value to be reached
+    TimelineHandle CreateTimeline(DeviceHandle device, uint64_t initialValue = 0);
+    void DestroyTimeline(DeviceHandle device, TimelineHandle &handle);
+
+    uint64_t GetTimelineValue(DeviceHandle device, TimelineHandle timeline);
+    bool WaitTimeline(DeviceHandle device, TimelineHandle timeline, uint64_t value, uint64_t timeout = UINT64_MAX); //false on timeout
+    void SignalTimeline(DeviceHandle device, TimelineHandle timeline, uint64_t value);
+
+    struct TimelinePoint
+    {
+        TimelineHandle timeline{nullptr};
+        uint64_t value{0};
+    };
+
     //============================ Buffer ============================
 
     enum class BufferMemoryType
@@ -333,11 +768,26 @@ using object##Handle = object##_T*;
         unsigned int size{0};
         BufferMemoryType memoryType{BufferMemoryType::GPU_ONLY};
         BufferUsageFlags usage{BufferUsageFlags::NONE};
+        bool dedicated{false}; //Own device memory instead of a range of a shared GPU_ONLY block
     };
 
     BufferHandle CreateBuffer(DeviceHandle device, const BufferCreateInfo &bufferCreateInfo);
     void DestroyBuffer(DeviceHandle device, BufferHandle &handle);
+
+    // Piece of a partial buffer update, `offset` is relative to the destination offset of the update
+    struct BufferUpdateRange
+    {
+        unsigned int offset{0};
+        unsigned int size{0};
+        const void* data{nullptr};
+    };
+
+    // Blocking helpers, the copy goes through the device upload batch (see Upload) and commandPool is unused
     void UpdateBuffer(DeviceHandle device, CommandPoolHandle commandPool, BufferHandle buffer, const void* data, unsigned int size);
+
+    // Writes every range at dstOffset + range.offset, ranges must not overlap.
+    // Host visible buffers are written in place, adjacent ranges of device-local ones are merged into a single copy.
+    void UpdateBufferRange(DeviceHandle device, CommandPoolHandle commandPool, BufferHandle buffer, unsigned int dstOffset, const BufferUpdateRange* ranges, unsigned int rangeCount);
     void CopyBuffer(DeviceHandle device, CommandPoolHandle commandPool, BufferHandle srcBuffer, BufferHandle dstBuffer, unsigned int size);
 
     //============================ Texture ============================
@@ -347,19 +797,6 @@ using object##Handle = object##_T*;
         TEXTURE_CUBE,
     };
 
-    enum class TextureFormat
-    {
-        // Color formats
-        RGBA8_UNORM,
-        RGBA8_SRGB,
-
-        // HDR formats
-        RGBA16_SFLOAT,
-
-        // Depth formats
-        D32_SFLOAT,
-    };
-
     enum class TextureUsageFlags : uint32_t
     {
         NONE = 0,
@@ -389,10 +826,68 @@ using object##Handle = object##_T*;
         unsigned int mipLevels{1};
     };
 
+    // Whether optimal tiling textures of `format` support every one of `usage`, answered from the capability cache
+    bool IsTextureFormatSupported(DeviceHandle device, TextureFormat format, TextureUsageFlags usage);
+
     TextureHandle CreateTexture(DeviceHandle device, const TextureCreateInfo& createInfo);
     void DestroyTexture(DeviceHandle device, TextureHandle &handle);
     // void UpdateTexture(DeviceHandle device, CommandPoolHandle commandPool, TextureHandle texture, const void* data, unsigned int size);
 
+    //============================ Upload ============================
+    // Transfers are recorded into a batch owned by the device and submitted together by FlushUploads.
+    // Each enqueue returns the token of the batch it landed in, a token is complete once its batch has executed.
+    // Token 0 is always complete (e.g. writes to host visible buffers, done on the spot).
+    //
+    // Example usage:
+    //     EnqueueBufferUpload(device, vertexBuffer, vertices, vertexSize);
+    //     EnqueueBufferUpload(device, indexBuffer, indices, indexSize);
+    //     UploadToken token = FlushUploads(device);
+    //     ...
+    //     if (IsUploadComplete(device, token)) { /* mesh can be drawn */ }
+    using UploadToken = uint64_t;
+
+    UploadToken EnqueueBufferUpload(DeviceHandle device, BufferHandle dstBuffer, const void* data, unsigned int size, unsigned int dstOffset = 0);
+    UploadToken EnqueueBufferUpdateRange(DeviceHandle device, BufferHandle dstBuffer, unsigned int dstOffset, const BufferUpdateRange* ranges, unsigned int rangeCount);
+    UploadToken EnqueueBufferCopy(DeviceHandle device, BufferHandle srcBuffer, BufferHandle dstBuffer, unsigned int size, unsigned int srcOffset = 0, unsigned int dstOffset = 0);
+
+    // Uploads every mip level of every layer and leaves the texture ready to be sampled. `data` holds mip 0 of each
+    // layer, then mip 1 of each layer and so on, tightly packed with each level half the size of the previous one.
+    UploadToken EnqueueTextureUpload(DeviceHandle device, TextureHandle texture, const void* data, unsigned int size);
+
+    UploadToken FlushUploads(DeviceHandle device);
+    bool IsUploadComplete(DeviceHandle device, UploadToken token);
+    void WaitUpload(DeviceHandle device, UploadToken token);
+
+    // Blocking copy of mip 0 of a texture written by an offscreen renderpass, tightly packed.
+    // The texture needs the TRANSFER_SRC usage, returns false if `size` is too small for it.
+    bool ReadTexture(DeviceHandle device, TextureHandle texture, void* data, unsigned int size);
+
+    //============================ Transient allocator ============================
+    // Linear allocator for data rewritten every frame (per-draw constants, ...) over one persistently mapped buffer.
+    // The buffer is split in frameCount regions, bind it once as a UBO_DYNAMIC binding with the range one draw reads
+    // and pass the allocation offsets as dynamic offsets. Attach the allocator to CmdBeginFrameInfo: each CmdBeginFrame
+    // moves to the next region once the frame fence has signaled, so frameCount has to match the frames in flight.
+    struct TransientAllocatorCreateInfo
+    {
+        unsigned int sizePerFrame{4 * 1024 * 1024};
+        unsigned int frameCount{2};
+        BufferUsageFlags usage{BufferUsageFlags::UNIFORM};
+    };
+
+    struct TransientAllocation
+    {
+        BufferHandle buffer{nullptr};
+        unsigned int offset{0}; //Offset in buffer, aligned to be used as a dynamic offset
+        unsigned int size{0};
+        void* data{nullptr};
+    };
+
+    TransientAllocatorHandle CreateTransientAllocator(DeviceHandle device, const TransientAllocatorCreateInfo& createInfo);
+    void DestroyTransientAllocator(DeviceHandle device, TransientAllocatorHandle& handle);
+
+    // Returns false when the region of the current frame is full
+    bool TransientAllocate(TransientAllocatorHandle allocator, unsigned int size, TransientAllocation& allocation);
+
     //============================ Sampler ============================
     enum class TextureFilter
     {
@@ -429,11 +924,13 @@ using object##Handle = object##_T*;
         FenceHandle inFlightFence;
         SemaphoreHandle imageAvailableSemaphore;
 
-        SwapchainHandle swapchain;
+        SwapchainHandle swapchain; //nullptr for offscreen frames, imageAvailableSemaphore is then unused
         CommandBufferHandle commandBuffer;
         RenderpassHandle renderpass;
         FramebufferHandle framebuffer;
 
+        TransientAllocatorHandle transientAllocator{nullptr}; //Optional, recycled once inFlightFence has signaled
+        DescriptorPoolHandle descriptorPool{nullptr}; //Optional, pool of this frame slot, reset once inFlightFence has signaled
     };
 
     unsigned int CmdBeginFrame(CmdBeginFrameInfo &info);
@@ -452,10 +949,160 @@ using object##Handle = object##_T*;
         SemaphoreHandle* renderFinishedSemaphore;
         unsigned int renderFinishedCount;
         CommandBufferHandle commandBuffer;
-        SwapchainHandle swapchain;
+        SwapchainHandle swapchain; //nullptr for offscreen frames, nothing is presented and the binary semaphores are unused
         unsigned int imageIndex;
+
+        //Optional, on top of the binary semaphores and the fence
+        const TimelinePoint* timelineWaits{nullptr};
+        unsigned int timelineWaitCount{0};
+        const TimelinePoint* timelineSignals{nullptr};
+        unsigned int timelineSignalCount{0};
     };
     void CmdSubmitFrame(CmdSubmitInfo& info);
 
+    // Binds, viewports and scissors matching what the command buffer already recorded are dropped, so they can be
+    // issued unconditionally per draw. Filtering starts over with every CmdBeginFrame and BeginCommandBuffer.
+
+    // Graphics and compute pipelines alike
+    void CmdBindPipeline(CommandBufferHandle commandBuffer, PipelineHandle pipeline);
+
+    struct Viewport
+    {
+        float x{0.0f};
+        float y{0.0f};
+        float width{0.0f};
+        float height{0.0f};
+        float minDepth{0.0f};
+        float maxDepth{1.0f};
+    };
+
+    // Every graphics pipeline takes its viewport and scissor from these, both must be set before drawing
+    void CmdSetViewport(CommandBufferHandle commandBuffer, const Viewport& viewport);
+    void CmdSetScissor(CommandBufferHandle commandBuffer, int x, int y, unsigned int width, unsigned int height);
+
+    enum class IndexType
+    {
+        UINT16, UINT32
+    };
+
+    // Binds `count` buffers to consecutive bindings starting at `firstBinding`, offsets may be nullptr for all 0.
+    // Only the bindings that changed are sent to the driver.
+    void CmdBindVertexBuffers(CommandBufferHandle commandBuffer, unsigned int firstBinding, const BufferHandle* buffers,
+                              const unsigned int* offsets, unsigned int count);
+    void CmdBindIndexBuffer(CommandBufferHandle commandBuffer, BufferHandle buffer, IndexType indexType,
+                            unsigned int offset = 0);
+
+    void CmdDraw(CommandBufferHandle commandBuffer, unsigned int vertexCount, unsigned int instanceCount = 1,
+                 unsigned int firstVertex = 0, unsigned int firstInstance = 0);
+    void CmdDrawIndexed(CommandBufferHandle commandBuffer, unsigned int indexCount, unsigned int instanceCount = 1,
+                        unsigned int firstIndex = 0, int vertexOffset = 0, unsigned int firstInstance = 0);
+
+    // Reads `drawCount` VkDrawIndirectCommand / VkDrawIndexedIndirectCommand `stride` bytes apart, the buffer needs
+    // the INDIRECT usage. More than one draw requires DeviceCapabilities::multiDrawIndirect.
+    void CmdDrawIndirect(CommandBufferHandle commandBuffer, BufferHandle buffer, unsigned int offset,
+                         unsigned int drawCount, unsigned int stride);
+    void CmdDrawIndexedIndirect(CommandBufferHandle commandBuffer, BufferHandle buffer, unsigned int offset,
+                                unsigned int drawCount, unsigned int stride);
+
+    // Dynamic state of pipelines created with useDynamicState, must be set before drawing with one
+    void CmdSetCullMode(CommandBufferHandle commandBuffer, CullMode cullMode);
+    void CmdSetFrontFace(CommandBufferHandle commandBuffer, FrontFace frontFace);
+    void CmdSetPrimitiveTopology(CommandBufferHandle commandBuffer, PrimitiveTopology topology);
+    void CmdSetDepthTestEnable(CommandBufferHandle commandBuffer, bool isEnabled);
+    void CmdSetDepthWriteEnable(CommandBufferHandle commandBuffer, bool isEnabled);
+    void CmdSetDepthCompareOp(CommandBufferHandle commandBuffer, CompareOp compareOp);
+    void CmdSetBlendEnable(CommandBufferHandle commandBuffer, bool isEnabled); //Requires DeviceCapabilities::dynamicBlendEnable
+
+    // Binds to the bind point and layout of `pipeline`, one dynamic offset per dynamic binding in binding order
+    void CmdBindDescriptorSets(CommandBufferHandle commandBuffer, PipelineHandle pipeline, unsigned int firstSet,
+                               const DescriptorSetHandle* sets, unsigned int setCount,
+                               const unsigned int* dynamicOffsets = nullptr, unsigned int dynamicOffsetCount = 0);
+
+    // Reaches every stage whose push constant range of `pipeline` overlaps the bytes written. Each of those ranges
+    // must contain the whole write, split writes that span ranges of different stages.
+    void CmdPushConstants(CommandBufferHandle commandBuffer, PipelineHandle pipeline, unsigned int offset,
+                          unsigned int size, const void* data);
+
+    // Writes into the push descriptor set of `pipeline`, the `set` of each write is ignored.
+    // Requires DeviceCapabilities::pushDescriptors.
+    void CmdPushDescriptorSet(CommandBufferHandle commandBuffer, PipelineHandle pipeline, const DescriptorWrite* writes,
+                              unsigned int writeCount);
+
+    // Dispatches are only valid outside of a render pass, record them between BeginCommandBuffer and EndCommandBuffer
+    void CmdDispatch(CommandBufferHandle commandBuffer, unsigned int groupCountX, unsigned int groupCountY = 1, unsigned int groupCountZ = 1);
+    // Reads a VkDispatchIndirectCommand (three uint32 group counts) at `offset`, the buffer needs the INDIRECT usage
+    void CmdDispatchIndirect(CommandBufferHandle commandBuffer, BufferHandle buffer, unsigned int offset = 0);
+
+    // Calls recorded since the last CmdBeginFrame or BeginCommandBuffer on the command buffer
+    struct CommandBufferStats
+    {
+        uint32_t issuedCalls{0}; //Reached the driver, draws and dispatches included
+        uint32_t filteredCalls{0}; //Dropped, the state they set was already recorded
+        uint32_t drawCalls{0};
+    };
+
+    CommandBufferStats GetCommandBufferStats(CommandBufferHandle commandBuffer);
+
+    // Recording outside of a frame and its render pass, for dispatches or for command buffers of a compute pool
+    // handed to QueueSubmit. Begin resets the command buffer and starts state filtering over.
+    void BeginCommandBuffer(CommandBufferHandle commandBuffer);
+    void EndCommandBuffer(CommandBufferHandle commandBuffer);
+
+    // Generic submission synchronised only through timelines, e.g. compute work signaling a timeline that a frame
+    // waits on through CmdSubmitInfo::timelineWaits. Command buffers must come from a pool of the same queue type.
+    struct QueueSubmitInfo
+    {
+        QueueType queue{QueueType::GRAPHICS};
+
+        const CommandBufferHandle* commandBuffers{nullptr};
+        unsigned int commandBufferCount{0};
+
+        const TimelinePoint* waits{nullptr};
+        unsigned int waitCount{0};
+        const TimelinePoint* signals{nullptr};
+        unsigned int signalCount{0};
+    };
+    void QueueSubmit(DeviceHandle device, const QueueSubmitInfo& info);
+
+    //============================ Frame manager ============================
+    // Ring of framesInFlight frame contexts (fence, image available semaphore, command pool and buffer, optional
+    // descriptor pool) plus the render finished semaphores of the swapchain and an optional transient allocator,
+    // rotated on every EndFrame. Without a swapchain frames render offscreen into image 0 of the framebuffer.
+    // BeginFrame only waits for the frame recorded framesInFlight frames ago, so recording overlaps GPU work.
+    //
+    // Example usage:
+    //     FrameInfo frame = BeginFrame(frameManager, renderpass, framebuffer);
+    //     // ... record into frame.commandBuffer
+    //     EndFrame(frameManager);
+    struct FrameManagerCreateInfo
+    {
+        SwapchainHandle swapchain{nullptr}; //nullptr for headless rendering, nothing is acquired or presented
+        unsigned int framesInFlight{2};
+
+        unsigned int transientSizePerFrame{0}; //0 = no transient allocator
+        BufferUsageFlags transientUsage{BufferUsageFlags::UNIFORM};
+
+        // One descriptor pool per frame slot sized from these layouts, reset when the slot comes back. 0 = no pools
+        const DescriptorSetlayoutHandle* descriptorLayouts{nullptr};
+        unsigned int descriptorLayoutCount{0};
+        unsigned int descriptorSetsPerFrame{0}; //Per layout
+    };
+
+    struct FrameInfo
+    {
+        CommandBufferHandle commandBuffer{nullptr};
+        TransientAllocatorHandle transientAllocator{nullptr};
+        DescriptorPoolHandle descriptorPool{nullptr};
+        unsigned int frameIndex{0};
+        unsigned int imageIndex{0};
+    };
+
+    FrameManagerHandle CreateFrameManager(DeviceHandle device, const FrameManagerCreateInfo& createInfo);
+    void DestroyFrameManager(DeviceHandle device, FrameManagerHandle& handle);
 
+    FrameInfo BeginFrame(FrameManagerHandle frameManager, RenderpassHandle renderpass, FramebufferHandle framebuffer);
+    // Ends the render pass, submits with the optional timeline points and presents when there is a swapchain
+    void EndFrame(FrameManagerHandle frameManager, const TimelinePoint* timelineWaits = nullptr,
+                  unsigned int timelineWaitCount = 0, const TimelinePoint* timelineSignals = nullptr,
+                  unsigned int timelineSignalCount = 0);
 }
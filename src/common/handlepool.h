@@ -0,0 +1,194 @@
+#pragma once
+#include <swarm/swarm.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace swarm
+{
+    // Host allocation through the callbacks given to InitSwarm
+    void *SwarmAllocate(size_t size, size_t alignment);
+    void SwarmFree(void *ptr);
+
+    // Pools register themselves when they first grow so ShutdownSwarm can give their slabs back
+    struct HandlePoolBase
+    {
+        HandlePoolBase *nextPool{nullptr};
+        bool isRegistered{false};
+
+        virtual void Release() = 0;
+    };
+
+    void RegisterHandlePool(HandlePoolBase *pool);
+
+    // Object storage comes first so a T* and its slot share the same address
+    template<typename T>
+    struct HandleSlot
+    {
+        alignas(T) unsigned char storage[sizeof(T)];
+        HandleSlot *nextFree{nullptr};
+        uint32_t generation{0};
+        bool isAllocated{false};
+        bool isAlive{false}; //Cleared by Retire when the user destroys the handle, its release may come later
+    };
+
+    // Objects of one type packed in slabs allocated through SwarmAllocate, slots are recycled through a free list.
+    // The generation of a slot grows every time it is released, caches can use it to tell a reused address apart.
+    template<typename T>
+    class HandlePool final : public HandlePoolBase
+    {
+    public:
+        using Slot = HandleSlot<T>;
+
+        template<typename... Args>
+        T *Create(Args &&... args)
+        {
+            Slot *slot = nullptr;
+            {
+                std::lock_guard lock(mutex);
+                if (!freeList && !Grow())
+                    return nullptr;
+
+                slot = freeList;
+                freeList = slot->nextFree;
+                slot->nextFree = nullptr;
+                slot->isAllocated = true;
+                slot->isAlive = true;
+            }
+
+            return new(slot->storage) T(std::forward<Args>(args)...);
+        }
+
+        void Destroy(T *ptr)
+        {
+            Slot *slot = ToSlot(ptr);
+            assert(slot->isAllocated && "handle destroyed twice or not created by this pool");
+
+            ptr->~T();
+
+            std::lock_guard lock(mutex);
+            slot->isAllocated = false;
+            slot->isAlive = false;
+            slot->generation++;
+
+#ifndef NDEBUG
+            // Only the oldest quarantined slot goes back to the free list
+            slot->nextFree = nullptr;
+            if (quarantineTail)
+                quarantineTail->nextFree = slot;
+            else
+                quarantineHead = slot;
+            quarantineTail = slot;
+
+            if (++quarantineCount <= QuarantineSize)
+                return;
+
+            slot = quarantineHead;
+            quarantineHead = slot->nextFree;
+            if (!quarantineHead)
+                quarantineTail = nullptr;
+            quarantineCount--;
+#endif
+
+            slot->nextFree = freeList;
+            freeList = slot;
+        }
+
+        static void Retire(T *ptr)
+        {
+            Slot *slot = ToSlot(ptr);
+            assert(slot->isAlive && "handle destroyed twice");
+            slot->isAlive = false;
+        }
+
+        static bool IsAlive(const T *ptr)
+        {
+            return ToSlot(ptr)->isAlive;
+        }
+
+        static uint32_t Generation(const T *ptr)
+        {
+            return ToSlot(ptr)->generation;
+        }
+
+        void Release() override
+        {
+            std::lock_guard lock(mutex);
+            while (slabs)
+            {
+                Slab *next = slabs->next;
+                SwarmFree(slabs);
+                slabs = next;
+            }
+            freeList = nullptr;
+#ifndef NDEBUG
+            quarantineHead = nullptr;
+            quarantineTail = nullptr;
+            quarantineCount = 0;
+#endif
+        }
+
+    private:
+        struct Slab
+        {
+            Slab *next{nullptr};
+        };
+
+        // Roughly a page per slab, small handles share cache lines with their neighbours
+        static constexpr size_t SlotsPerSlab = std::max<size_t>(4, 4096 / sizeof(Slot));
+        static constexpr size_t SlotsOffset = (sizeof(Slab) + alignof(Slot) - 1) & ~(alignof(Slot) - 1);
+
+        static Slot *ToSlot(const T *ptr)
+        {
+            return reinterpret_cast<Slot *>(const_cast<T *>(ptr));
+        }
+
+        bool Grow()
+        {
+            void *memory = SwarmAllocate(SlotsOffset + SlotsPerSlab * sizeof(Slot), std::max(alignof(Slab), alignof(Slot)));
+            if (!memory)
+                return false;
+
+            Slab *slab = new(memory) Slab();
+            slab->next = slabs;
+            slabs = slab;
+
+            // Chained backwards so the first slots of the slab are handed out first
+            Slot *slots = reinterpret_cast<Slot *>(static_cast<unsigned char *>(memory) + SlotsOffset);
+            for (size_t i = SlotsPerSlab; i-- > 0;)
+            {
+                Slot *slot = new(&slots[i]) Slot();
+                slot->nextFree = freeList;
+                freeList = slot;
+            }
+
+            if (!isRegistered)
+                RegisterHandlePool(this);
+
+            return true;
+        }
+
+        std::mutex mutex;
+        Slab *slabs{nullptr};
+        Slot *freeList{nullptr};
+
+#ifndef NDEBUG
+        // Debug builds hold released slots back for this many releases, IsHandleAlive keeps catching a stale handle
+        // instead of seeing the next object created at its address
+        static constexpr size_t QuarantineSize = 256;
+        Slot *quarantineHead{nullptr};
+        Slot *quarantineTail{nullptr};
+        size_t quarantineCount{0};
+#endif
+    };
+
+    template<typename T>
+    HandlePool<T> &GetHandlePool()
+    {
+        static HandlePool<T> pool;
+        return pool;
+    }
+}
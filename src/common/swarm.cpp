@@ -1,5 +1,7 @@
 #include <swarm_internal.h>
 
+#include <cassert>
+#include <cstddef>
 #include <cstdlib>
 
 namespace swarm
@@ -28,14 +30,77 @@ namespace swarm
             };
         }
 
+        // The size only hooks can't honour an alignment above malloc's, nothing the library allocates needs one
+        SwarmAllocationCallbacks &callbacks = g_SwarmLibrary.allocationCallbacks;
+        callbacks = {};
+        callbacks.allocFn = [](void *, size_t size, size_t alignment) -> void*
+        {
+            assert(alignment <= alignof(std::max_align_t));
+            return g_SwarmLibrary.allocFn(static_cast<unsigned int>(size));
+        };
+        callbacks.freeFn = [](void *, void *ptr) -> void
+        {
+            g_SwarmLibrary.freeFn(ptr);
+        };
+
+        g_SwarmLibrary.forwardAllocationCallbacks = false;
         g_SwarmLibrary.isInitialized = true;
         return true;
     }
 
+    bool InitSwarm(const SwarmAllocationCallbacks &allocationCallbacks)
+    {
+        if (g_SwarmLibrary.isInitialized)
+            return true;
+
+        assert(allocationCallbacks.allocFn && allocationCallbacks.reallocFn && allocationCallbacks.freeFn);
+
+        g_SwarmLibrary.allocationCallbacks = allocationCallbacks;
+        g_SwarmLibrary.forwardAllocationCallbacks = true;
+        g_SwarmLibrary.isInitialized = true;
+        return true;
+    }
+
+    void *SwarmAllocate(size_t size, size_t alignment)
+    {
+        const SwarmAllocationCallbacks &callbacks = g_SwarmLibrary.allocationCallbacks;
+        return callbacks.allocFn(callbacks.userData, size, alignment);
+    }
+
+    void SwarmFree(void *ptr)
+    {
+        const SwarmAllocationCallbacks &callbacks = g_SwarmLibrary.allocationCallbacks;
+        callbacks.freeFn(callbacks.userData, ptr);
+    }
+
+    void RegisterHandlePool(HandlePoolBase *pool)
+    {
+        std::lock_guard lock(g_SwarmLibrary.poolsMutex);
+        pool->nextPool = g_SwarmLibrary.pools;
+        pool->isRegistered = true;
+        g_SwarmLibrary.pools = pool;
+    }
+
     void ShutdownSwarm()
     {
+        // Handles still alive at this point are leaked by the user, their slabs go away with the rest
+        {
+            std::lock_guard lock(g_SwarmLibrary.poolsMutex);
+            for (HandlePoolBase *pool = g_SwarmLibrary.pools; pool;)
+            {
+                HandlePoolBase *next = pool->nextPool;
+                pool->Release();
+                pool->nextPool = nullptr;
+                pool->isRegistered = false;
+                pool = next;
+            }
+            g_SwarmLibrary.pools = nullptr;
+        }
+
+        g_SwarmLibrary.allocationCallbacks = {};
         g_SwarmLibrary.allocFn = nullptr;
         g_SwarmLibrary.freeFn = nullptr;
+        g_SwarmLibrary.forwardAllocationCallbacks = false;
         g_SwarmLibrary.isInitialized = false;
     }
 
@@ -1,31 +1,63 @@
 #pragma once
 #include <utility>
+#include <mutex>
 #include <swarm/swarm.h>
 
+#include "handlepool.h"
+
 namespace swarm
 {
     struct SwarmLibrary
     {
+        SwarmAllocationCallbacks allocationCallbacks;
+
+        // Size only hooks of the legacy InitSwarm, wrapped by allocationCallbacks
         SwarmAllocFn allocFn{nullptr};
         SwarmFreeFn freeFn{nullptr};
 
+        // Only callbacks given by the user are handed to the driver, it has its own default allocator
+        bool forwardAllocationCallbacks{false};
+
+        std::mutex poolsMutex;
+        HandlePoolBase *pools{nullptr};
+
         bool isInitialized{false};
     };
 
     extern SwarmLibrary g_SwarmLibrary;
 
+    // Objects live in the slabs of their type's pool, memory is only allocated when a pool runs out of slots
     template<typename T, typename... Args>
     T *SWARM_NEW(Args &&... args)
     {
-        T *ptr = static_cast<T *>(g_SwarmLibrary.allocFn(sizeof(T)));
-        new(ptr) T(std::forward<Args>(args)...);
-        return ptr;
+        return GetHandlePool<T>().Create(std::forward<Args>(args)...);
     }
 
     template<typename T>
     void SWARM_DELETE(T *ptr)
     {
-        ptr->~T(); // Explicitly call destructor
-        g_SwarmLibrary.freeFn(ptr);
+        GetHandlePool<T>().Destroy(ptr);
+    }
+
+    // Debug check against handles used after being destroyed. Debug builds quarantine released slots before reusing
+    // them, release builds recycle them right away and the check is only reliable until then.
+    template<typename T>
+    bool IsHandleAlive(const T *ptr)
+    {
+        return ptr && HandlePool<T>::IsAlive(ptr);
+    }
+
+    // Called by the public Destroy functions, the handle is dead from then on even if its release is deferred
+    template<typename T>
+    void RetireHandle(T *ptr)
+    {
+        HandlePool<T>::Retire(ptr);
+    }
+
+    // Grows every time the slot of the handle is recycled, tells a reused address apart from the previous object
+    template<typename T>
+    uint32_t GetHandleGeneration(const T *ptr)
+    {
+        return HandlePool<T>::Generation(ptr);
     }
 }
@@ -0,0 +1,382 @@
+#include <swarm/swarm.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SWARM_VERTEX_ENCODER_SSE2
+#include <emmintrin.h>
+// GCC and Clang define __F16C__ whenever it is enabled, MSVC has no such macro but /arch:AVX2 implies F16C
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define SWARM_VERTEX_ENCODER_F16C
+#include <immintrin.h>
+#endif
+#endif
+
+namespace swarm
+{
+    unsigned int GetVertexAttributeSize(VertexAttributeType type)
+    {
+        switch (type)
+        {
+            case VertexAttributeType::FLOAT:
+            case VertexAttributeType::INT:
+            case VertexAttributeType::UINT:
+                return 4;
+            case VertexAttributeType::VEC2:
+            case VertexAttributeType::IVEC2:
+            case VertexAttributeType::UVEC2:
+                return 8;
+            case VertexAttributeType::VEC3:
+            case VertexAttributeType::IVEC3:
+            case VertexAttributeType::UVEC3:
+                return 12;
+            case VertexAttributeType::VEC4:
+            case VertexAttributeType::IVEC4:
+            case VertexAttributeType::UVEC4:
+                return 16;
+            case VertexAttributeType::HALF2:
+            case VertexAttributeType::SNORM8X4:
+            case VertexAttributeType::UNORM8X4:
+            case VertexAttributeType::SNORM16X2:
+            case VertexAttributeType::UNORM16X2:
+            case VertexAttributeType::SNORM_A2B10G10R10:
+            case VertexAttributeType::UNORM_A2B10G10R10:
+                return 4;
+            case VertexAttributeType::HALF4:
+            case VertexAttributeType::SNORM16X4:
+                return 8;
+        }
+        return 0;
+    }
+
+    static unsigned int GetFloatComponentCount(VertexAttributeType type)
+    {
+        switch (type)
+        {
+            case VertexAttributeType::FLOAT:
+                return 1;
+            case VertexAttributeType::VEC2:
+                return 2;
+            case VertexAttributeType::VEC3:
+                return 3;
+            case VertexAttributeType::VEC4:
+                return 4;
+            default:
+                return 0;
+        }
+    }
+
+    static bool IsPackedFloatType(VertexAttributeType type)
+    {
+        return GetFloatComponentCount(type) > 0 || type >= VertexAttributeType::HALF2;
+    }
+
+#ifdef SWARM_VERTEX_ENCODER_SSE2
+    // Missing components read as 0, a VEC3 never loads past its last float
+    static __m128 LoadComponents(const float *values, unsigned int count)
+    {
+        switch (count)
+        {
+            case 1:
+                return _mm_load_ss(values);
+            case 2:
+                return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(values)));
+            case 3:
+                return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double *>(values))),
+                                     _mm_load_ss(values + 2));
+            default:
+                return _mm_loadu_ps(values);
+        }
+    }
+
+    static __m128i ToSnorm(__m128 values, float scale)
+    {
+        values = _mm_min_ps(_mm_max_ps(values, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+        return _mm_cvtps_epi32(_mm_mul_ps(values, _mm_set1_ps(scale)));
+    }
+
+    static __m128i ToUnorm(__m128 values, float scale)
+    {
+        values = _mm_min_ps(_mm_max_ps(values, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        return _mm_cvtps_epi32(_mm_mul_ps(values, _mm_set1_ps(scale)));
+    }
+
+    // Round to nearest even, handles subnormals, infinities and NaN. The four halves end up in the low 64 bits.
+    static __m128i FloatToHalf(__m128 values)
+    {
+#ifdef SWARM_VERTEX_ENCODER_F16C
+        return _mm_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+#else
+        const __m128i maxHalf = _mm_set1_epi32((127 + 16) << 23);
+        const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+        const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+        const __m128 sign = _mm_and_ps(values, _mm_set1_ps(-0.0f));
+        const __m128 absolute = _mm_xor_ps(values, sign);
+        const __m128i absoluteBits = _mm_castps_si128(absolute);
+
+        const __m128i isNaN = _mm_castps_si128(_mm_cmpunord_ps(absolute, absolute));
+        const __m128i isRegular = _mm_cmpgt_epi32(maxHalf, absoluteBits);
+        const __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absoluteBits);
+        const __m128i special = _mm_or_si128(_mm_and_si128(isNaN, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+        const __m128 subnormalSum = _mm_add_ps(absolute, _mm_castsi128_ps(subnormalMagic));
+        const __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(subnormalSum), subnormalMagic);
+
+        const __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absoluteBits, 31 - 13), 31);
+        const __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absoluteBits, normalBias), mantissaOdd), 13);
+
+        const __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+        const __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+
+        // The sign is shifted in arithmetically, lanes stay in the int16 range and the signed pack keeps their bits
+        return _mm_packs_epi32(_mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16)), _mm_setzero_si128());
+#endif
+    }
+
+    static void Store32(void *destination, __m128i values)
+    {
+        const int32_t low = _mm_cvtsi128_si32(values);
+        memcpy(destination, &low, sizeof(low));
+    }
+
+    static uint32_t PackA2B10G10R10(__m128i values)
+    {
+        alignas(16) int32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lanes), values);
+        return (lanes[0] & 0x3ff) | (lanes[1] & 0x3ff) << 10 | (lanes[2] & 0x3ff) << 20 | static_cast<uint32_t>(lanes[3] & 0x3) << 30;
+    }
+
+    static void EncodeAttribute(VertexAttributeType type, const float *source, unsigned int componentCount, void *destination)
+    {
+        const __m128 values = LoadComponents(source, componentCount);
+
+        switch (type)
+        {
+            case VertexAttributeType::HALF2:
+            case VertexAttributeType::HALF4:
+            {
+                const __m128i halves = FloatToHalf(values);
+                if (type == VertexAttributeType::HALF2)
+                    Store32(destination, halves);
+                else
+                    _mm_storel_epi64(static_cast<__m128i *>(destination), halves);
+                break;
+            }
+            case VertexAttributeType::SNORM8X4:
+            {
+                const __m128i words = _mm_packs_epi32(ToSnorm(values, 127.0f), _mm_setzero_si128());
+                Store32(destination, _mm_packs_epi16(words, _mm_setzero_si128()));
+                break;
+            }
+            case VertexAttributeType::UNORM8X4:
+            {
+                const __m128i words = _mm_packs_epi32(ToUnorm(values, 255.0f), _mm_setzero_si128());
+                Store32(destination, _mm_packus_epi16(words, _mm_setzero_si128()));
+                break;
+            }
+            case VertexAttributeType::SNORM16X2:
+                Store32(destination, _mm_packs_epi32(ToSnorm(values, 32767.0f), _mm_setzero_si128()));
+                break;
+            case VertexAttributeType::SNORM16X4:
+                _mm_storel_epi64(static_cast<__m128i *>(destination), _mm_packs_epi32(ToSnorm(values, 32767.0f), _mm_setzero_si128()));
+                break;
+            case VertexAttributeType::UNORM16X2:
+            {
+                // SSE2 only packs with signed saturation, the range is moved down by 32768 and flipped back after
+                const __m128i bias = _mm_set1_epi32(32768);
+                const __m128i words = _mm_packs_epi32(_mm_sub_epi32(ToUnorm(values, 65535.0f), bias), _mm_setzero_si128());
+                Store32(destination, _mm_xor_si128(words, _mm_set1_epi16(static_cast<short>(0x8000))));
+                break;
+            }
+            case VertexAttributeType::SNORM_A2B10G10R10:
+            {
+                const uint32_t packed = PackA2B10G10R10(_mm_cvtps_epi32(_mm_mul_ps(
+                    _mm_min_ps(_mm_max_ps(values, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f)), _mm_setr_ps(511.0f, 511.0f, 511.0f, 1.0f))));
+                memcpy(destination, &packed, sizeof(packed));
+                break;
+            }
+            case VertexAttributeType::UNORM_A2B10G10R10:
+            {
+                const uint32_t packed = PackA2B10G10R10(_mm_cvtps_epi32(_mm_mul_ps(
+                    _mm_min_ps(_mm_max_ps(values, _mm_setzero_ps()), _mm_set1_ps(1.0f)), _mm_setr_ps(1023.0f, 1023.0f, 1023.0f, 3.0f))));
+                memcpy(destination, &packed, sizeof(packed));
+                break;
+            }
+            default:
+                memcpy(destination, source, GetVertexAttributeSize(type));
+                break;
+        }
+    }
+#else
+    static int32_t ToSnorm(float value, float scale)
+    {
+        return static_cast<int32_t>(std::lrint(std::clamp(value, -1.0f, 1.0f) * scale));
+    }
+
+    static uint32_t ToUnorm(float value, float scale)
+    {
+        return static_cast<uint32_t>(std::lrint(std::clamp(value, 0.0f, 1.0f) * scale));
+    }
+
+    // Round to nearest even, same results as the SSE2 path
+    static uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        const uint32_t sign = (bits >> 16) & 0x8000;
+        const uint32_t absolute = bits & 0x7fffffff;
+
+        if (absolute > 0x7f800000)
+            return static_cast<uint16_t>(sign | 0x7e00);
+        if (absolute >= (127 + 16) << 23)
+            return static_cast<uint16_t>(sign | 0x7c00);
+        if (absolute < (127 - 14) << 23)
+        {
+            float magic;
+            const uint32_t magicBits = ((127 - 15) + (23 - 10) + 1) << 23;
+            memcpy(&magic, &magicBits, sizeof(magic));
+
+            float absoluteValue;
+            memcpy(&absoluteValue, &absolute, sizeof(absoluteValue));
+            absoluteValue += magic;
+
+            uint32_t subnormal;
+            memcpy(&subnormal, &absoluteValue, sizeof(subnormal));
+            return static_cast<uint16_t>(sign | (subnormal - magicBits));
+        }
+
+        const uint32_t mantissaOdd = (absolute >> 13) & 1;
+        return static_cast<uint16_t>(sign | ((absolute + 0xfff - ((127 - 15) << 23) + mantissaOdd) >> 13));
+    }
+
+    static void EncodeAttribute(VertexAttributeType type, const float *source, unsigned int componentCount, void *destination)
+    {
+        float values[4]{};
+        std::copy_n(source, componentCount, values);
+
+        switch (type)
+        {
+            case VertexAttributeType::HALF2:
+            case VertexAttributeType::HALF4:
+            {
+                const unsigned int count = type == VertexAttributeType::HALF2 ? 2 : 4;
+                uint16_t halves[4];
+                for (unsigned int i = 0; i < count; i++)
+                    halves[i] = FloatToHalf(values[i]);
+                memcpy(destination, halves, count * sizeof(uint16_t));
+                break;
+            }
+            case VertexAttributeType::SNORM8X4:
+            case VertexAttributeType::UNORM8X4:
+            {
+                uint8_t bytes[4];
+                for (unsigned int i = 0; i < 4; i++)
+                    bytes[i] = type == VertexAttributeType::SNORM8X4
+                                   ? static_cast<uint8_t>(ToSnorm(values[i], 127.0f))
+                                   : static_cast<uint8_t>(ToUnorm(values[i], 255.0f));
+                memcpy(destination, bytes, sizeof(bytes));
+                break;
+            }
+            case VertexAttributeType::SNORM16X2:
+            case VertexAttributeType::SNORM16X4:
+            case VertexAttributeType::UNORM16X2:
+            {
+                const unsigned int count = type == VertexAttributeType::SNORM16X4 ? 4 : 2;
+                uint16_t words[4];
+                for (unsigned int i = 0; i < count; i++)
+                    words[i] = type == VertexAttributeType::UNORM16X2
+                                   ? static_cast<uint16_t>(ToUnorm(values[i], 65535.0f))
+                                   : static_cast<uint16_t>(ToSnorm(values[i], 32767.0f));
+                memcpy(destination, words, count * sizeof(uint16_t));
+                break;
+            }
+            case VertexAttributeType::SNORM_A2B10G10R10:
+            case VertexAttributeType::UNORM_A2B10G10R10:
+            {
+                const bool isSnorm = type == VertexAttributeType::SNORM_A2B10G10R10;
+                uint32_t lanes[4];
+                for (unsigned int i = 0; i < 4; i++)
+                {
+                    const float scale = i < 3 ? (isSnorm ? 511.0f : 1023.0f) : (isSnorm ? 1.0f : 3.0f);
+                    lanes[i] = isSnorm ? static_cast<uint32_t>(ToSnorm(values[i], scale)) : ToUnorm(values[i], scale);
+                }
+                const uint32_t packed = (lanes[0] & 0x3ff) | (lanes[1] & 0x3ff) << 10 | (lanes[2] & 0x3ff) << 20 | (lanes[3] & 0x3) << 30;
+                memcpy(destination, &packed, sizeof(packed));
+                break;
+            }
+            default:
+                memcpy(destination, source, GetVertexAttributeSize(type));
+                break;
+        }
+    }
+#endif
+
+    bool EncodeVertices(const VertexSpecification &source, const void *sourceData,
+                        const VertexSpecification &packed, void *packedData, size_t vertexCount)
+    {
+        assert(sourceData || vertexCount == 0);
+        assert(packedData || vertexCount == 0);
+
+        if (source.bindingCount != 1 || packed.bindingCount != 1)
+            return false;
+
+        struct EncodedAttribute
+        {
+            unsigned int sourceOffset;
+            unsigned int componentCount;
+            unsigned int packedOffset;
+            VertexAttributeType packedType;
+        };
+
+        // Resolved once, the vertex loop then only walks this table
+        EncodedAttribute encoded[32];
+        unsigned int encodedCount = 0;
+        for (unsigned int i = 0; i < packed.attributeCount; i++)
+        {
+            const VertexAttribute &packedAttribute = packed.attributes[i];
+            const VertexAttribute *sourceAttribute = std::find_if(source.attributes, source.attributes + source.attributeCount,
+                                                                  [&](const VertexAttribute &attribute)
+                                                                  {
+                                                                      return attribute.location == packedAttribute.location;
+                                                                  });
+
+            if (sourceAttribute == source.attributes + source.attributeCount ||
+                GetFloatComponentCount(sourceAttribute->type) == 0 ||
+                !IsPackedFloatType(packedAttribute.type) ||
+                encodedCount == std::size(encoded))
+                return false;
+
+            encoded[encodedCount++] = {sourceAttribute->offset, GetFloatComponentCount(sourceAttribute->type),
+                                       packedAttribute.offset, packedAttribute.type};
+        }
+
+        const auto *sourceBytes = static_cast<const unsigned char *>(sourceData);
+        auto *packedBytes = static_cast<unsigned char *>(packedData);
+        const unsigned int sourceStride = source.bindings[0].stride;
+        const unsigned int packedStride = packed.bindings[0].stride;
+
+        for (size_t vertex = 0; vertex < vertexCount; vertex++)
+        {
+            const unsigned char *sourceVertex = sourceBytes + vertex * sourceStride;
+            unsigned char *packedVertex = packedBytes + vertex * packedStride;
+
+            for (unsigned int i = 0; i < encodedCount; i++)
+            {
+                // Zeroed so a float type wider than the source copies no uninitialised bytes
+                float components[4] = {};
+                memcpy(components, sourceVertex + encoded[i].sourceOffset, encoded[i].componentCount * sizeof(float));
+                EncodeAttribute(encoded[i].packedType, components, encoded[i].componentCount, packedVertex + encoded[i].packedOffset);
+            }
+        }
+
+        return true;
+    }
+}
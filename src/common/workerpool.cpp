@@ -0,0 +1,70 @@
+#include "workerpool.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace swarm
+{
+    WorkerPool::~WorkerPool()
+    {
+        Stop();
+    }
+
+    void WorkerPool::Start(unsigned int threadCount)
+    {
+        assert(threads.empty());
+
+        if (threadCount == 0)
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        isStopping = false;
+        threads.reserve(threadCount);
+        for (unsigned int i = 0; i < threadCount; i++)
+            threads.emplace_back(&WorkerPool::Run, this);
+    }
+
+    void WorkerPool::Stop()
+    {
+        {
+            std::lock_guard lock(mutex);
+            isStopping = true;
+        }
+        condition.notify_all();
+
+        for (std::thread &thread : threads)
+            thread.join();
+        threads.clear();
+    }
+
+    void WorkerPool::Submit(std::function<void()> &&job)
+    {
+        assert(IsRunning());
+
+        {
+            std::lock_guard lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        condition.notify_one();
+    }
+
+    void WorkerPool::Run()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [this]() { return isStopping || !jobs.empty(); });
+
+                // Queued jobs still run when stopping, their callers may be waiting on them
+                if (jobs.empty())
+                    return;
+
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+
+            job();
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swarm
+{
+    // Fixed set of threads running jobs in submission order, started on first use
+    class WorkerPool
+    {
+    public:
+        WorkerPool() = default;
+        WorkerPool(const WorkerPool &) = delete;
+        WorkerPool &operator=(const WorkerPool &) = delete;
+        ~WorkerPool();
+
+        // 0 threads picks one less than the hardware concurrency, at least one
+        void Start(unsigned int threadCount);
+
+        // Runs the jobs already queued then joins the threads
+        void Stop();
+
+        bool IsRunning() const { return !threads.empty(); }
+
+        void Submit(std::function<void()> &&job);
+
+    private:
+        void Run();
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::function<void()>> jobs;
+        std::vector<std::thread> threads;
+        bool isStopping{false};
+    };
+}
@@ -2,14 +2,18 @@
 
 #include <vulkan/vulkan.h>
 #include <swarm/swarm.h>
+
+#include <algorithm>
+#include <cassert>
 #include <vector>
+
+#include "vkcapabilities.h"
 namespace swarm
 {
-    inline VkFormat FindSupportedFormat(VkPhysicalDevice physDevice, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
+    inline VkFormat FindSupportedFormat(const DeviceCapabilityCache& capabilities, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features)
     {
         for (VkFormat format : candidates) {
-            VkFormatProperties props;
-            vkGetPhysicalDeviceFormatProperties(physDevice, format, &props);
+            const VkFormatProperties& props = GetFormatProperties(capabilities, format);
 
             if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
                 return format;
@@ -21,19 +25,18 @@ namespace swarm
         return VK_FORMAT_UNDEFINED;
     }
 
-    inline VkFormat FindDepthFormat(VkPhysicalDevice physDevice)
+    inline VkFormat FindDepthFormat(const DeviceCapabilityCache& capabilities)
     {
-        return FindSupportedFormat(physDevice,
+        return FindSupportedFormat(capabilities,
              {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
              VK_IMAGE_TILING_OPTIMAL,
              VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
          );
     }
 
-    inline unsigned int FindMemoryType(VkPhysicalDevice physicalDevice, unsigned int typeFilter, VkMemoryPropertyFlags properties)
+    inline unsigned int FindMemoryType(const DeviceCapabilityCache& capabilities, unsigned int typeFilter, VkMemoryPropertyFlags properties)
     {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+        const VkPhysicalDeviceMemoryProperties& memProperties = capabilities.memoryProperties;
 
         for (unsigned int i = 0; i < memProperties.memoryTypeCount; i++)
         {
@@ -62,6 +65,15 @@ namespace swarm
             case VertexAttributeType::UVEC2: return VK_FORMAT_R32G32_UINT;
             case VertexAttributeType::UVEC3: return VK_FORMAT_R32G32B32_UINT;
             case VertexAttributeType::UVEC4: return VK_FORMAT_R32G32B32A32_UINT;
+            case VertexAttributeType::HALF2: return VK_FORMAT_R16G16_SFLOAT;
+            case VertexAttributeType::HALF4: return VK_FORMAT_R16G16B16A16_SFLOAT;
+            case VertexAttributeType::SNORM8X4: return VK_FORMAT_R8G8B8A8_SNORM;
+            case VertexAttributeType::UNORM8X4: return VK_FORMAT_R8G8B8A8_UNORM;
+            case VertexAttributeType::SNORM16X2: return VK_FORMAT_R16G16_SNORM;
+            case VertexAttributeType::SNORM16X4: return VK_FORMAT_R16G16B16A16_SNORM;
+            case VertexAttributeType::UNORM16X2: return VK_FORMAT_R16G16_UNORM;
+            case VertexAttributeType::SNORM_A2B10G10R10: return VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+            case VertexAttributeType::UNORM_A2B10G10R10: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
         }
         return VK_FORMAT_UNDEFINED;
     }
@@ -76,7 +88,9 @@ namespace swarm
             VkVertexInputBindingDescription bindingDesc{};
             bindingDesc.binding = vertexSpec.bindings[i].binding;
             bindingDesc.stride = vertexSpec.bindings[i].stride;
-            bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            bindingDesc.inputRate = vertexSpec.bindings[i].inputRate == VertexInputRate::INSTANCE
+                                        ? VK_VERTEX_INPUT_RATE_INSTANCE
+                                        : VK_VERTEX_INPUT_RATE_VERTEX;
             bindings.push_back(bindingDesc);
         }
 
@@ -90,10 +104,12 @@ namespace swarm
 
         for (unsigned int i = 0; i < vertexSpec.attributeCount; ++i)
         {
+            assert(std::any_of(vertexSpec.bindings, vertexSpec.bindings + vertexSpec.bindingCount,
+                               [&](const VertexBinding &binding) { return binding.binding == vertexSpec.attributes[i].binding; }) &&
+                   "vertex attribute refers to a binding missing from the specification");
+
             VkVertexInputAttributeDescription attrDesc{};
-            // For now, assume all attributes use binding 0, but this could be extended
-            // by adding a binding field to VertexAttribute in the future
-            attrDesc.binding = 0;
+            attrDesc.binding = vertexSpec.attributes[i].binding;
             attrDesc.location = vertexSpec.attributes[i].location;
             attrDesc.format = VertexAttributeTypeToVkFormat(vertexSpec.attributes[i].type);
             attrDesc.offset = vertexSpec.attributes[i].offset;
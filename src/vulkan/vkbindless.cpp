@@ -0,0 +1,266 @@
+#include "vkbindless.h"
+#include "vkbuffer.h"
+#include "vkdescriptorpool.h"
+#include "vkdescriptorsetlayout.h"
+#include "vkdevice.h"
+#include "vksampler.h"
+#include "vktexture.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+namespace swarm
+{
+    static uint32_t AcquireIndex(BindlessSlots &slots)
+    {
+        if (!slots.freeIndices.empty())
+        {
+            const uint32_t index = slots.freeIndices.back();
+            slots.freeIndices.pop_back();
+            return index;
+        }
+
+        return slots.nextIndex < slots.capacity ? slots.nextIndex++ : INVALID_BINDLESS_INDEX;
+    }
+
+    static BindlessSlots &GetSlots(BindlessHeap &heap, BindlessBinding binding)
+    {
+        switch (binding)
+        {
+            case BINDLESS_TEXTURES:
+                return heap.textures;
+            case BINDLESS_SAMPLERS:
+                return heap.samplers;
+            default:
+                return heap.buffers;
+        }
+    }
+
+    bool CreateBindlessHeap(Device_T *device, VkPhysicalDevice physicalDevice, const DeviceCreateInfo &createInfo,
+                            BindlessHeap &heap)
+    {
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+        indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &indexingProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+        heap.textures.capacity = std::min({createInfo.bindlessTextureCount,
+                                           indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+                                           indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages});
+        heap.samplers.capacity = std::min({createInfo.bindlessSamplerCount,
+                                           indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                                           indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers});
+        heap.buffers.capacity = std::min({createInfo.bindlessBufferCount,
+                                          indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                          indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings(3);
+        const std::array<VkDescriptorType, 3> types = {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, VK_DESCRIPTOR_TYPE_SAMPLER,
+                                                       VK_DESCRIPTOR_TYPE_STORAGE_BUFFER};
+        const std::array<uint32_t, 3> counts = {std::max(heap.textures.capacity, 1u), std::max(heap.samplers.capacity, 1u),
+                                                std::max(heap.buffers.capacity, 1u)};
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            bindings[i].binding = i;
+            bindings[i].descriptorType = types[i];
+            bindings[i].descriptorCount = counts[i];
+            bindings[i].stageFlags = VK_SHADER_STAGE_ALL;
+        }
+
+        // Slots are written while earlier submissions still use other slots of the same set
+        std::array<VkDescriptorBindingFlags, 3> bindingFlags{};
+        bindingFlags.fill(VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT);
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+        bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.pNext = &bindingFlagsInfo;
+        layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+        layoutInfo.pBindings = bindings.data();
+
+        VkDescriptorSetLayout setLayout{VK_NULL_HANDLE};
+        if (vkCreateDescriptorSetLayout(device->device, &layoutInfo, GetHostAllocator(), &setLayout) != VK_SUCCESS)
+            return false;
+
+        std::vector<VkDescriptorPoolSize> poolSizes(3);
+        for (uint32_t i = 0; i < 3; i++)
+            poolSizes[i] = {types[i], counts[i]};
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        if (vkCreateDescriptorPool(device->device, &poolInfo, GetHostAllocator(), &heap.pool) != VK_SUCCESS)
+        {
+            vkDestroyDescriptorSetLayout(device->device, setLayout, GetHostAllocator());
+            return false;
+        }
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = heap.pool;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &setLayout;
+
+        VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+        if (vkAllocateDescriptorSets(device->device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+        {
+            vkDestroyDescriptorPool(device->device, heap.pool, GetHostAllocator());
+            vkDestroyDescriptorSetLayout(device->device, setLayout, GetHostAllocator());
+            heap.pool = VK_NULL_HANDLE;
+            return false;
+        }
+
+        // Regular handles so pipelines and CmdBindDescriptorSets take the heap like any other set
+        heap.layout = SWARM_NEW<DescriptorSetlayout_T>();
+        heap.layout->setLayout = setLayout;
+        heap.layout->bindings = std::move(bindings);
+
+        heap.set = SWARM_NEW<DescriptorSet_T>();
+        heap.set->set = descriptorSet;
+        heap.set->layout = heap.layout;
+        return true;
+    }
+
+    void DestroyBindlessHeap(Device_T *device, BindlessHeap &heap)
+    {
+        if (!IsBindlessEnabled(heap))
+            return;
+
+        vkDestroyDescriptorPool(device->device, heap.pool, GetHostAllocator());
+        vkDestroyDescriptorSetLayout(device->device, heap.layout->setLayout, GetHostAllocator());
+        SWARM_DELETE(heap.set);
+        SWARM_DELETE(heap.layout);
+
+        heap.pool = VK_NULL_HANDLE;
+        heap.set = nullptr;
+        heap.layout = nullptr;
+    }
+
+    static void WriteHeapDescriptor(Device_T *device, BindlessBinding binding, uint32_t index,
+                                    const VkDescriptorImageInfo *imageInfo, const VkDescriptorBufferInfo *bufferInfo)
+    {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = device->bindlessHeap.set->set;
+        write.dstBinding = binding;
+        write.dstArrayElement = index;
+        write.descriptorCount = 1;
+        write.descriptorType = device->bindlessHeap.layout->bindings[binding].descriptorType;
+        write.pImageInfo = imageInfo;
+        write.pBufferInfo = bufferInfo;
+
+        vkUpdateDescriptorSets(device->device, 1, &write, 0, nullptr);
+    }
+
+    uint32_t AddBindlessTexture(Device_T *device, const Texture_T *texture)
+    {
+        BindlessHeap &heap = device->bindlessHeap;
+        if (!IsBindlessEnabled(heap))
+            return INVALID_BINDLESS_INDEX;
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.imageView = texture->imageView;
+        imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        std::lock_guard lock(heap.mutex);
+        const uint32_t index = AcquireIndex(heap.textures);
+        if (index != INVALID_BINDLESS_INDEX)
+            WriteHeapDescriptor(device, BINDLESS_TEXTURES, index, &imageInfo, nullptr);
+
+        return index;
+    }
+
+    uint32_t AddBindlessSampler(Device_T *device, VkSampler sampler)
+    {
+        BindlessHeap &heap = device->bindlessHeap;
+        if (!IsBindlessEnabled(heap))
+            return INVALID_BINDLESS_INDEX;
+
+        VkDescriptorImageInfo imageInfo{};
+        imageInfo.sampler = sampler;
+
+        std::lock_guard lock(heap.mutex);
+        const uint32_t index = AcquireIndex(heap.samplers);
+        if (index != INVALID_BINDLESS_INDEX)
+            WriteHeapDescriptor(device, BINDLESS_SAMPLERS, index, &imageInfo, nullptr);
+
+        return index;
+    }
+
+    uint32_t AddBindlessBuffer(Device_T *device, const Buffer_T *buffer)
+    {
+        BindlessHeap &heap = device->bindlessHeap;
+        if (!IsBindlessEnabled(heap))
+            return INVALID_BINDLESS_INDEX;
+
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = buffer->buffer;
+        bufferInfo.offset = buffer->offset;
+        bufferInfo.range = std::min<VkDeviceSize>(buffer->size,
+                                                  device->capabilityCache.properties.limits.maxStorageBufferRange);
+
+        std::lock_guard lock(heap.mutex);
+        const uint32_t index = AcquireIndex(heap.buffers);
+        if (index != INVALID_BINDLESS_INDEX)
+            WriteHeapDescriptor(device, BINDLESS_BUFFERS, index, nullptr, &bufferInfo);
+
+        return index;
+    }
+
+    void ReleaseBindlessIndex(Device_T *device, BindlessBinding binding, uint32_t index)
+    {
+        if (index == INVALID_BINDLESS_INDEX)
+            return;
+
+        std::lock_guard lock(device->bindlessHeap.mutex);
+        GetSlots(device->bindlessHeap, binding).freeIndices.push_back(index);
+    }
+
+    uint32_t GetBindlessIndex(TextureHandle texture)
+    {
+        assert(texture);
+        return texture->bindlessIndex;
+    }
+
+    uint32_t GetBindlessIndex(SamplerHandle sampler)
+    {
+        assert(sampler);
+        return sampler->bindlessIndex;
+    }
+
+    uint32_t GetBindlessIndex(BufferHandle buffer)
+    {
+        assert(buffer);
+        return buffer->bindlessIndex;
+    }
+
+    DescriptorSetlayoutHandle GetBindlessDescriptorSetlayout(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        return device->bindlessHeap.layout;
+    }
+
+    DescriptorSetHandle GetBindlessDescriptorSet(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        return device->bindlessHeap.set;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+#include <mutex>
+#include <vector>
+namespace swarm
+{
+    struct Device_T;
+    struct DescriptorSet_T;
+    struct DescriptorSetlayout_T;
+    struct Texture_T;
+    struct Buffer_T;
+
+    enum BindlessBinding : uint32_t
+    {
+        BINDLESS_TEXTURES = 0,
+        BINDLESS_SAMPLERS = 1,
+        BINDLESS_BUFFERS = 2,
+    };
+
+    // Indices of one array of the heap, released ones are handed out again before growing
+    struct BindlessSlots
+    {
+        std::vector<uint32_t> freeIndices;
+        uint32_t nextIndex{0};
+        uint32_t capacity{0};
+    };
+
+    // Single update-after-bind set every sampled texture, sampler and storage buffer is written to on creation
+    struct BindlessHeap
+    {
+        std::mutex mutex;
+        VkDescriptorPool pool{VK_NULL_HANDLE};
+        DescriptorSetlayout_T *layout{nullptr};
+        DescriptorSet_T *set{nullptr};
+
+        BindlessSlots textures;
+        BindlessSlots samplers;
+        BindlessSlots buffers;
+    };
+
+    inline bool IsBindlessEnabled(const BindlessHeap &heap)
+    {
+        return heap.set != nullptr;
+    }
+
+    // Array sizes are clamped to the update-after-bind limits of `physicalDevice`
+    bool CreateBindlessHeap(Device_T *device, VkPhysicalDevice physicalDevice, const DeviceCreateInfo &createInfo,
+                            BindlessHeap &heap);
+    void DestroyBindlessHeap(Device_T *device, BindlessHeap &heap);
+
+    // INVALID_BINDLESS_INDEX when bindless is off or the array is full
+    uint32_t AddBindlessTexture(Device_T *device, const Texture_T *texture);
+    uint32_t AddBindlessSampler(Device_T *device, VkSampler sampler);
+    uint32_t AddBindlessBuffer(Device_T *device, const Buffer_T *buffer);
+
+    // Only once the GPU is done with the resource, its descriptor stays in place until the index is reused
+    void ReleaseBindlessIndex(Device_T *device, BindlessBinding binding, uint32_t index);
+}
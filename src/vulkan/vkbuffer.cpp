@@ -2,7 +2,10 @@
 #include "vkdevice.h"
 #include "vkcommandpool.h"
 #include "swarm_internal.h"
+#include "vkdescriptorcache.h"
+#include "vkbindless.h"
 
+#include <algorithm>
 #include <cassert>
 #include <vulkan/vulkan_core.h>
 #include <vk_mem_alloc.h>
@@ -37,7 +40,7 @@ namespace swarm
         return flags;
     }
 
-    VmaAllocationCreateInfo GetAllocationInfo(BufferMemoryType memoryType)
+    VmaAllocationCreateInfo GetAllocationInfo(BufferMemoryType memoryType, bool dedicated)
     {
         VmaAllocationCreateInfo allocInfo{};
         allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
@@ -46,7 +49,7 @@ namespace swarm
         {
             case BufferMemoryType::GPU_ONLY:
                 // Device-local, best performance
-                allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+                allocInfo.flags = dedicated ? VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT : 0;
                 allocInfo.priority = 1.0f; // High priority for GPU resources
                 break;
 
@@ -72,18 +75,152 @@ namespace swarm
         return allocInfo;
     }
 
+    // Every usage a suballocated buffer can ask for, blocks are shared between all of them
+    constexpr VkBufferUsageFlags blockUsageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                   VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                                   VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+    static BufferBlock *CreateBufferBlock(DeviceHandle device, VkDeviceSize size)
+    {
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = blockUsageFlags;
+        SetQueueSharing(device, createInfo);
+
+        VmaAllocationCreateInfo allocInfo = GetAllocationInfo(BufferMemoryType::GPU_ONLY, true);
+
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        if (vmaCreateBuffer(device->allocator, &createInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS)
+        {
+            return nullptr;
+        }
+
+        VmaVirtualBlockCreateInfo blockInfo{};
+        blockInfo.size = size;
+
+        VmaVirtualBlock virtualBlock{VK_NULL_HANDLE};
+        if (vmaCreateVirtualBlock(&blockInfo, &virtualBlock) != VK_SUCCESS)
+        {
+            vmaDestroyBuffer(device->allocator, buffer, allocation);
+            return nullptr;
+        }
+
+        BufferBlock *block = SWARM_NEW<BufferBlock>();
+        block->buffer = buffer;
+        block->allocation = allocation;
+        block->virtualBlock = virtualBlock;
+        block->size = size;
+
+        device->bufferBlocks.push_back(block);
+        return block;
+    }
+
+    static void DestroyBufferBlock(DeviceHandle device, BufferBlock *block)
+    {
+        // Buffers still alive in the block are leaked by the user, don't let VMA assert on them
+        vmaClearVirtualBlock(block->virtualBlock);
+        vmaDestroyVirtualBlock(block->virtualBlock);
+        vmaDestroyBuffer(device->allocator, block->buffer, block->allocation);
+
+        SWARM_DELETE(block);
+    }
+
+    // Empty blocks give their memory back, except the last one so a lone buffer recreated every frame doesn't churn
+    static void ReleaseSuballocation(Device_T *device, BufferBlock *block, VmaVirtualAllocation virtualAllocation)
+    {
+        std::lock_guard lock(device->bufferBlocksMutex);
+
+        vmaVirtualFree(block->virtualBlock, virtualAllocation);
+        if (!vmaIsVirtualBlockEmpty(block->virtualBlock) || device->bufferBlocks.size() == 1)
+            return;
+
+        std::erase(device->bufferBlocks, block);
+        DestroyBufferBlock(device, block);
+    }
+
+    void DestroyBufferBlocks(Device_T *device)
+    {
+        for (BufferBlock *block: device->bufferBlocks)
+        {
+            DestroyBufferBlock(device, block);
+        }
+        device->bufferBlocks.clear();
+    }
+
+    static BufferHandle CreateSuballocatedBuffer(DeviceHandle device, const BufferCreateInfo &bufferCreateInfo)
+    {
+        const VkPhysicalDeviceLimits &limits = device->capabilityCache.properties.limits;
+
+        // The same range may end up bound as uniform, storage, index or vertex data
+        VmaVirtualAllocationCreateInfo allocInfo{};
+        allocInfo.size = bufferCreateInfo.size;
+        allocInfo.alignment = std::max<VkDeviceSize>({limits.minUniformBufferOffsetAlignment,
+                                                      limits.minStorageBufferOffsetAlignment, 16});
+
+        VmaVirtualAllocation virtualAllocation{VK_NULL_HANDLE};
+        VkDeviceSize offset = 0;
+        BufferBlock *block = nullptr;
+        {
+            std::lock_guard lock(device->bufferBlocksMutex);
+            for (BufferBlock *candidate: device->bufferBlocks)
+            {
+                if (vmaVirtualAllocate(candidate->virtualBlock, &allocInfo, &virtualAllocation, &offset) == VK_SUCCESS)
+                {
+                    block = candidate;
+                    break;
+                }
+            }
+
+            if (!block)
+            {
+                block = CreateBufferBlock(device, device->bufferBlockSize);
+                if (!block ||
+                    vmaVirtualAllocate(block->virtualBlock, &allocInfo, &virtualAllocation, &offset) != VK_SUCCESS)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        BufferHandle handle = SWARM_NEW<Buffer_T>();
+        handle->buffer = block->buffer;
+        handle->allocation = VK_NULL_HANDLE;
+        handle->size = bufferCreateInfo.size;
+        handle->usage = TranslateUsageFlags(bufferCreateInfo.usage);
+        handle->block = block;
+        handle->virtualAllocation = virtualAllocation;
+        handle->offset = offset;
+        handle->createdSubmission = device->submissionValue;
+        handle->createdComputeSubmission = device->computeSubmissionValue;
+        if (handle->usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+            handle->bindlessIndex = AddBindlessBuffer(device, handle);
+
+        return handle;
+    }
+
     BufferHandle CreateBuffer(DeviceHandle device, const BufferCreateInfo &bufferCreateInfo)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
 
+        // Small device-local buffers share big blocks instead of each owning a VkDeviceMemory
+        const bool isLarge = bufferCreateInfo.size > device->bufferBlockSize / 4;
+        const bool isDedicated = bufferCreateInfo.dedicated || isLarge;
+        if (bufferCreateInfo.memoryType == BufferMemoryType::GPU_ONLY && !isDedicated)
+        {
+            return CreateSuballocatedBuffer(device, bufferCreateInfo);
+        }
+
         VkBufferCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         createInfo.size = bufferCreateInfo.size;
         createInfo.usage = TranslateUsageFlags(bufferCreateInfo.usage);
-        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        SetQueueSharing(device, createInfo);
 
-        VmaAllocationCreateInfo allocInfo = GetAllocationInfo(bufferCreateInfo.memoryType);
+        VmaAllocationCreateInfo allocInfo = GetAllocationInfo(bufferCreateInfo.memoryType, isDedicated);
 
         VkBuffer buffer{VK_NULL_HANDLE};
         VmaAllocation allocation{VK_NULL_HANDLE};
@@ -97,8 +234,13 @@ namespace swarm
         BufferHandle handle = SWARM_NEW<Buffer_T>();
         handle->buffer = buffer;
         handle->size = bufferCreateInfo.size;
+        handle->usage = createInfo.usage;
         handle->allocation = allocation;
         handle->mappedData = allocationInfo.pMappedData;
+        handle->createdSubmission = device->submissionValue;
+        handle->createdComputeSubmission = device->computeSubmissionValue;
+        if (handle->usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+            handle->bindlessIndex = AddBindlessBuffer(device, handle);
 
         return handle;
     }
@@ -108,11 +250,24 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vmaDestroyBuffer(device->allocator, handle->buffer, handle->allocation);
-
-        SWARM_DELETE(handle);
+        BufferHandle buffer = handle;
+        RetireHandle(buffer);
+        EvictCachedDescriptorSets(device, buffer);
+        DestroyDeferred(device, [device, buffer]()
+        {
+            if (buffer->block)
+            {
+                ReleaseSuballocation(device, buffer->block, buffer->virtualAllocation);
+            } else
+            {
+                vmaDestroyBuffer(device->allocator, buffer->buffer, buffer->allocation);
+            }
+            ReleaseBindlessIndex(device, BINDLESS_BUFFERS, buffer->bindlessIndex);
+
+            SWARM_DELETE(buffer);
+        });
         handle = nullptr;
     }
 
@@ -120,78 +275,37 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(buffer);
+        assert(IsHandleAlive(buffer));
         assert(data);
         assert(size > 0 && size <= buffer->size);
 
-        if (buffer->mappedData)
-        {
-            memcpy(buffer->mappedData, data, size);
-        } else
-        {
-            // Create a temporary staging buffer
-            BufferCreateInfo stagingInfo{};
-            stagingInfo.usage = BufferUsageFlags::TRANSFER_SRC;
-            stagingInfo.memoryType = BufferMemoryType::CPU_TO_GPU;
-            stagingInfo.size = size;
-            BufferHandle stagingBuffer = CreateBuffer(device, stagingInfo);
-
-            // Copy data to staging buffer
-            memcpy(stagingBuffer->mappedData, data, size);
+        BufferUpdateRange range{};
+        range.offset = 0;
+        range.size = size;
+        range.data = data;
+        UpdateBufferRange(device, commandPool, buffer, 0, &range, 1);
+    }
 
-            // Copy from staging to destination buffer using a command buffer
-            CopyBuffer(device, commandPool, stagingBuffer, buffer, size);
+    void UpdateBufferRange(DeviceHandle device, CommandPoolHandle commandPool, BufferHandle buffer, unsigned int dstOffset,
+                           const BufferUpdateRange *ranges, unsigned int rangeCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(buffer));
 
-            // Clean up staging buffer
-            DestroyBuffer(device, stagingBuffer);
-        }
+        const UploadToken token = EnqueueBufferUpdateRange(device, buffer, dstOffset, ranges, rangeCount);
+        if (token != 0)
+            WaitUpload(device, FlushUploads(device));
     }
 
     void CopyBuffer(DeviceHandle device, CommandPoolHandle commandPool, BufferHandle srcBuffer, BufferHandle dstBuffer, unsigned int size)
     {
         assert(device);
-        assert(commandPool);
-        assert(srcBuffer);
-        assert(dstBuffer);
+        assert(IsHandleAlive(srcBuffer));
+        assert(IsHandleAlive(dstBuffer));
         assert(size > 0);
 
-        // Create a one-time command buffer
-        VkCommandBufferAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocInfo.commandPool = commandPool->commandPool;
-        allocInfo.commandBufferCount = 1;
-
-        VkCommandBuffer commandBuffer;
-        vkAllocateCommandBuffers(device->device, &allocInfo, &commandBuffer);
-
-        // Begin recording
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-        vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-        // Record the copy command
-        VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer->buffer, dstBuffer->buffer, 1, &copyRegion);
-
-        // End recording
-        vkEndCommandBuffer(commandBuffer);
-
-        // Submit and execute
-        VkSubmitInfo submitInfo{};
-        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = &commandBuffer;
-
-        vkQueueSubmit(device->device.get_queue(vkb::QueueType::graphics).value(), 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(device->device.get_queue(vkb::QueueType::graphics).value());
-
-        // Clean up
-        vkFreeCommandBuffers(device->device, commandPool->commandPool, 1, &commandBuffer);
+        EnqueueBufferCopy(device, srcBuffer, dstBuffer, size);
+        WaitUpload(device, FlushUploads(device));
     }
 }
@@ -4,8 +4,21 @@
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 
+#include <vector>
+
 namespace swarm
 {
+    struct Device_T;
+
+    // Large device-local buffer that small GPU_ONLY buffers are carved out of
+    struct BufferBlock
+    {
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        VmaVirtualBlock virtualBlock{VK_NULL_HANDLE};
+        VkDeviceSize size{0};
+    };
+
     struct Buffer_T
     {
         VkBuffer buffer;
@@ -14,5 +27,17 @@ namespace swarm
 
         VkDeviceSize size;
         VkBufferUsageFlags usage;
+
+        // Set for suballocated buffers, `buffer` is then the block buffer and every access has to add `offset`
+        BufferBlock* block{nullptr};
+        VmaVirtualAllocation virtualAllocation{VK_NULL_HANDLE};
+        VkDeviceSize offset{0};
+
+        uint64_t createdSubmission{0}; //Device submission value at creation, no earlier submission can use the buffer
+        uint64_t createdComputeSubmission{0}; //Same for the async compute queue
+        uint32_t bindlessIndex{INVALID_BINDLESS_INDEX}; //STORAGE buffers only, see GetBindlessIndex
     };
+
+    VkBufferUsageFlags TranslateUsageFlags(BufferUsageFlags usage);
+    void DestroyBufferBlocks(Device_T* device);
 }
@@ -0,0 +1,19 @@
+#include "vkcapabilities.h"
+#include "utils.h"
+
+namespace swarm
+{
+    void CacheDeviceCapabilities(VkPhysicalDevice physicalDevice, DeviceCapabilityCache &cache)
+    {
+        vkGetPhysicalDeviceProperties(physicalDevice, &cache.properties);
+        vkGetPhysicalDeviceFeatures(physicalDevice, &cache.features);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &cache.memoryProperties);
+
+        for (size_t i = 0; i < cache.formats.size(); i++)
+        {
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, static_cast<VkFormat>(i), &cache.formats[i]);
+        }
+
+        cache.depthFormat = FindDepthFormat(cache);
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+namespace swarm
+{
+    // Every core format, from VK_FORMAT_UNDEFINED to the last ASTC one
+    constexpr size_t FormatTableSize = VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1;
+
+    // Driver queries made once at device creation, nothing after that needs to go back to the driver
+    struct DeviceCapabilityCache
+    {
+        VkPhysicalDeviceProperties properties{};
+        VkPhysicalDeviceFeatures features{};
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        std::array<VkFormatProperties, FormatTableSize> formats{};
+
+        VkFormat depthFormat{VK_FORMAT_UNDEFINED};
+    };
+
+    void CacheDeviceCapabilities(VkPhysicalDevice physicalDevice, DeviceCapabilityCache &cache);
+
+    // Formats outside of the core range report no features
+    inline const VkFormatProperties &GetFormatProperties(const DeviceCapabilityCache &cache, VkFormat format)
+    {
+        static const VkFormatProperties unsupported{};
+        const auto index = static_cast<size_t>(format);
+        return index < cache.formats.size() ? cache.formats[index] : unsupported;
+    }
+}
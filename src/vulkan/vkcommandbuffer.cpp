@@ -32,6 +32,7 @@ namespace swarm
 
         CommandBufferHandle handle = SWARM_NEW<CommandBuffer_T>();
         handle->commandBuffer = commandBuffer;
+        handle->device = device;
 
         return handle;
     }
@@ -40,7 +41,7 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
         vkFreeCommandBuffers(device->device, commandPool->commandPool, 1, &handle->commandBuffer); //TODO: maybe receive a vector of command buffers
 
@@ -2,10 +2,58 @@
 #include <swarm_internal.h>
 
 #include <vulkan/vulkan.h>
+#include <array>
 namespace swarm
 {
+    // Last state recorded into a command buffer, calls setting it again are dropped before reaching the driver
+    struct CommandBufferState
+    {
+        static constexpr uint32_t MAX_VERTEX_BINDINGS = 16;
+        static constexpr uint32_t MAX_DESCRIPTOR_SETS = 8;
+        static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 8; //Per set, sets with more are never filtered
+
+        struct BoundSet
+        {
+            VkDescriptorSet set{VK_NULL_HANDLE};
+            uint32_t dynamicOffsetCount{0};
+            std::array<uint32_t, MAX_DYNAMIC_OFFSETS> dynamicOffsets{};
+        };
+
+        // Graphics and compute bindings are independent, indexed by VkPipelineBindPoint
+        struct BindPointState
+        {
+            VkPipeline pipeline{VK_NULL_HANDLE};
+            VkPipelineLayout setLayout{VK_NULL_HANDLE}; //The sets below were bound with it
+            std::array<BoundSet, MAX_DESCRIPTOR_SETS> sets{};
+        };
+        std::array<BindPointState, 2> bindPoints{};
+
+        std::array<VkBuffer, MAX_VERTEX_BINDINGS> vertexBuffers{};
+        std::array<VkDeviceSize, MAX_VERTEX_BINDINGS> vertexOffsets{};
+
+        VkBuffer indexBuffer{VK_NULL_HANDLE};
+        VkDeviceSize indexOffset{0};
+        VkIndexType indexType{VK_INDEX_TYPE_UINT16};
+
+        bool hasViewport{false};
+        VkViewport viewport{};
+        bool hasScissor{false};
+        VkRect2D scissor{};
+    };
+
     struct CommandBuffer_T
     {
         VkCommandBuffer commandBuffer;
+        DeviceHandle device{nullptr};
+
+        // Both start over whenever recording begins
+        CommandBufferState state;
+        CommandBufferStats stats;
     };
+
+    inline void ResetCommandBufferState(CommandBuffer_T *commandBuffer)
+    {
+        commandBuffer->state = {};
+        commandBuffer->stats = {};
+    }
 }
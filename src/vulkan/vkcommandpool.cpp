@@ -6,7 +6,7 @@
 
 namespace swarm
 {
-    CommandPoolHandle CreateCommandPool(DeviceHandle device)
+    CommandPoolHandle CreateCommandPool(DeviceHandle device, QueueType queue)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
@@ -14,10 +14,12 @@ namespace swarm
         VkCommandPoolCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-        createInfo.queueFamilyIndex = device->device.get_queue_index(vkb::QueueType::graphics).value();
+        createInfo.queueFamilyIndex = queue == QueueType::COMPUTE && device->computeQueue != VK_NULL_HANDLE
+                                          ? device->computeQueueFamily
+                                          : device->graphicsQueueFamily;
 
         VkCommandPool commandPool {VK_NULL_HANDLE};
-        if (vkCreateCommandPool(device->device, &createInfo, nullptr, &commandPool) != VK_SUCCESS)
+        if (vkCreateCommandPool(device->device, &createInfo, GetHostAllocator(), &commandPool) != VK_SUCCESS)
         {
             return nullptr;
         }
@@ -33,9 +35,9 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vkDestroyCommandPool(device->device, handle->commandPool, nullptr);
+        vkDestroyCommandPool(device->device, handle->commandPool, GetHostAllocator());
 
         SWARM_DELETE(handle);
     }
@@ -0,0 +1,271 @@
+#include "vkdescriptorcache.h"
+#include "vkdescriptorpool.h"
+#include "vkdescriptorsetlayout.h"
+#include "vkdevice.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace swarm
+{
+    static constexpr uint32_t CACHED_SETS_PER_BLOCK = 32;
+
+    size_t DescriptorSetKeyHash::operator()(const DescriptorSetKey &key) const
+    {
+        size_t seed = key.resources.size();
+        for (const DescriptorResourceKey &resource : key.resources)
+        {
+            HashCombine(seed, resource.binding);
+            HashCombine(seed, resource.arrayElement);
+            HashHandleKey(seed, resource.resource);
+            HashHandleKey(seed, resource.sampler);
+            HashCombine(seed, resource.offset);
+            HashCombine(seed, resource.range);
+        }
+        return seed;
+    }
+
+    static DescriptorSetKey BuildDescriptorSetKey(const DescriptorSetlayout_T *layout, const DescriptorWrite *writes,
+                                                  unsigned int writeCount)
+    {
+        DescriptorSetKey key;
+        for (unsigned int i = 0; i < writeCount; i++)
+        {
+            const DescriptorWrite &write = writes[i];
+            const VkDescriptorSetLayoutBinding *binding = FindLayoutBinding(layout, write.binding);
+            assert(binding && "binding missing from the layout");
+
+            const bool isBuffer = IsBufferDescriptor(binding->descriptorType);
+            assert(isBuffer ? write.buffers != nullptr : write.images != nullptr);
+
+            for (unsigned int j = 0; j < write.count; j++)
+            {
+                DescriptorResourceKey &resource = key.resources.emplace_back();
+                resource.binding = write.binding;
+                resource.arrayElement = write.arrayElement + j;
+
+                if (isBuffer)
+                {
+                    resource.resource = MakeHandleKey(write.buffers[j].buffer);
+                    resource.offset = write.buffers[j].offset;
+                    resource.range = write.buffers[j].range;
+                } else
+                {
+                    resource.resource = MakeHandleKey(write.images[j].texture);
+                    resource.sampler = MakeHandleKey(write.images[j].sampler);
+                }
+            }
+        }
+
+        std::sort(key.resources.begin(), key.resources.end(),
+                  [](const DescriptorResourceKey &a, const DescriptorResourceKey &b)
+                  {
+                      return a.binding != b.binding ? a.binding < b.binding : a.arrayElement < b.arrayElement;
+                  });
+        return key;
+    }
+
+    static DescriptorSetCache *CreateDescriptorSetCache(const DescriptorSetlayout_T *layout)
+    {
+        DescriptorSetCache *cache = SWARM_NEW<DescriptorSetCache>();
+        for (const VkDescriptorSetLayoutBinding &binding : layout->bindings)
+            cache->blockSizes.push_back({binding.descriptorType, binding.descriptorCount * CACHED_SETS_PER_BLOCK});
+
+        return cache;
+    }
+
+    // Cached sets are freed one by one on eviction, so any block may have room again
+    static bool AllocateCachedSet(Device_T *device, const DescriptorSetlayout_T *layout, DescriptorSetCache *cache,
+                                  VkDescriptorPool &block, VkDescriptorSet &set)
+    {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout->setLayout;
+
+        for (auto it = cache->blocks.rbegin(); it != cache->blocks.rend(); ++it)
+        {
+            allocInfo.descriptorPool = *it;
+
+            VkResult result = vkAllocateDescriptorSets(device->device, &allocInfo, &set);
+            if (result == VK_SUCCESS)
+            {
+                block = *it;
+                return true;
+            }
+
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+                return false;
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        poolInfo.maxSets = CACHED_SETS_PER_BLOCK;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(cache->blockSizes.size());
+        poolInfo.pPoolSizes = cache->blockSizes.data();
+
+        VkDescriptorPool newBlock{VK_NULL_HANDLE};
+        if (vkCreateDescriptorPool(device->device, &poolInfo, GetHostAllocator(), &newBlock) != VK_SUCCESS)
+            return false;
+        cache->blocks.push_back(newBlock);
+
+        allocInfo.descriptorPool = newBlock;
+        if (vkAllocateDescriptorSets(device->device, &allocInfo, &set) != VK_SUCCESS)
+            return false;
+
+        block = newBlock;
+        return true;
+    }
+
+    // A resource bound twice in the same set is only registered once, so eviction never sees the set twice
+    static void RegisterUser(Device_T *device, const HandleKey &resource, DescriptorSet_T *set)
+    {
+        if (!resource.handle)
+            return;
+
+        std::vector<DescriptorSet_T*> &users = device->descriptorSetUsers[resource.handle];
+        if (users.empty() || users.back() != set)
+            users.push_back(set);
+    }
+
+    static void UnregisterUser(Device_T *device, const HandleKey &resource, DescriptorSet_T *set)
+    {
+        auto it = device->descriptorSetUsers.find(resource.handle);
+        if (it == device->descriptorSetUsers.end())
+            return;
+
+        std::erase(it->second, set);
+        if (it->second.empty())
+            device->descriptorSetUsers.erase(it);
+    }
+
+    static void UnregisterUsers(Device_T *device, DescriptorSet_T *set)
+    {
+        for (const DescriptorResourceKey &resource : set->cacheKey->resources)
+        {
+            UnregisterUser(device, resource.resource, set);
+            UnregisterUser(device, resource.sampler, set);
+        }
+    }
+
+    DescriptorSetHandle GetCachedDescriptorSet(DeviceHandle device, DescriptorSetlayoutHandle layout,
+                                               const DescriptorWrite *writes, unsigned int writeCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(layout) && !layout->isPushDescriptor);
+        assert(writes || writeCount == 0);
+
+        DescriptorSetKey key = BuildDescriptorSetKey(layout, writes, writeCount);
+
+        std::lock_guard lock(device->descriptorCacheMutex);
+        if (!layout->setCache)
+            layout->setCache = CreateDescriptorSetCache(layout);
+        DescriptorSetCache *cache = layout->setCache;
+
+        auto it = cache->entries.find(key);
+        if (it != cache->entries.end())
+        {
+            device->descriptorCacheStats.hits++;
+            return it->second;
+        }
+        device->descriptorCacheStats.misses++;
+
+        VkDescriptorPool block{VK_NULL_HANDLE};
+        VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+        if (!AllocateCachedSet(device, layout, cache, block, descriptorSet))
+            return nullptr;
+
+        DescriptorSetHandle set = SWARM_NEW<DescriptorSet_T>();
+        set->set = descriptorSet;
+        set->layout = layout;
+        set->block = block;
+
+        std::vector<DescriptorWrite> setWrites(writes, writes + writeCount);
+        for (DescriptorWrite &write : setWrites)
+            write.set = set;
+        UpdateDescriptorSets(device, setWrites.data(), writeCount);
+
+        auto inserted = cache->entries.emplace(std::move(key), set).first;
+        set->cacheKey = &inserted->first;
+
+        for (const DescriptorResourceKey &resource : set->cacheKey->resources)
+        {
+            RegisterUser(device, resource.resource, set);
+            RegisterUser(device, resource.sampler, set);
+        }
+
+        device->descriptorCacheStats.setCount++;
+        return set;
+    }
+
+    void EvictCachedDescriptorSets(Device_T *device, const void *resource)
+    {
+        std::lock_guard lock(device->descriptorCacheMutex);
+
+        auto users = device->descriptorSetUsers.find(resource);
+        if (users == device->descriptorSetUsers.end())
+            return;
+
+        std::vector<DescriptorSet_T*> sets = std::move(users->second);
+        device->descriptorSetUsers.erase(users);
+
+        for (DescriptorSet_T *set : sets)
+        {
+            UnregisterUsers(device, set);
+            RetireHandle(set);
+
+            DescriptorSetCache *cache = set->layout->setCache;
+            cache->entries.erase(cache->entries.find(*set->cacheKey));
+            set->cacheKey = nullptr;
+
+            device->descriptorCacheStats.evictions++;
+            device->descriptorCacheStats.setCount--;
+
+            // Released in submission order, so always before the layout cache destroys the block
+            DestroyDeferred(device, [device, set]()
+            {
+                vkFreeDescriptorSets(device->device, set->block, 1, &set->set);
+                SWARM_DELETE(set);
+            });
+        }
+    }
+
+    void DestroyDescriptorSetCache(Device_T *device, DescriptorSetlayout_T *layout)
+    {
+        std::lock_guard lock(device->descriptorCacheMutex);
+
+        DescriptorSetCache *cache = layout->setCache;
+        if (!cache)
+            return;
+
+        for (const auto &[key, set] : cache->entries)
+        {
+            UnregisterUsers(device, set);
+            RetireHandle(set);
+        }
+
+        device->descriptorCacheStats.setCount -= static_cast<uint32_t>(cache->entries.size());
+        layout->setCache = nullptr;
+
+        DestroyDeferred(device, [device, cache]()
+        {
+            for (VkDescriptorPool block : cache->blocks)
+                vkDestroyDescriptorPool(device->device, block, GetHostAllocator());
+
+            for (const auto &[key, set] : cache->entries)
+                SWARM_DELETE(set);
+            SWARM_DELETE(cache);
+        });
+    }
+
+    DescriptorSetCacheStats GetDescriptorSetCacheStats(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        std::lock_guard lock(device->descriptorCacheMutex);
+        return device->descriptorCacheStats;
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include "vkpipeline.h"
+
+#include <vulkan/vulkan.h>
+#include <unordered_map>
+#include <vector>
+namespace swarm
+{
+    struct Device_T;
+    struct DescriptorSet_T;
+    struct DescriptorSetlayout_T;
+
+    // One written array element, buffer bindings leave `sampler` empty
+    struct DescriptorResourceKey
+    {
+        uint32_t binding{0};
+        uint32_t arrayElement{0};
+        HandleKey resource;
+        HandleKey sampler;
+        uint32_t offset{0};
+        uint32_t range{0};
+
+        bool operator==(const DescriptorResourceKey &other) const = default;
+    };
+
+    // Contents of a set sorted by binding and element, the order of the writes doesn't matter
+    struct DescriptorSetKey
+    {
+        std::vector<DescriptorResourceKey> resources;
+
+        bool operator==(const DescriptorSetKey &other) const = default;
+    };
+
+    struct DescriptorSetKeyHash
+    {
+        size_t operator()(const DescriptorSetKey &key) const;
+    };
+
+    // Written sets of one layout by content, allocated from blocks that can free sets one by one
+    struct DescriptorSetCache
+    {
+        std::unordered_map<DescriptorSetKey, DescriptorSet_T*, DescriptorSetKeyHash> entries;
+
+        std::vector<VkDescriptorPool> blocks;
+        std::vector<VkDescriptorPoolSize> blockSizes;
+    };
+
+    // Drops every cached set referencing `resource`, called when a buffer, texture or sampler is destroyed
+    void EvictCachedDescriptorSets(Device_T *device, const void *resource);
+
+    // Releases the cache of a layout being destroyed along with all its sets
+    void DestroyDescriptorSetCache(Device_T *device, DescriptorSetlayout_T *layout);
+}
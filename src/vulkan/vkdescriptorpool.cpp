@@ -0,0 +1,265 @@
+#include "vkdescriptorpool.h"
+#include "vkdescriptorsetlayout.h"
+#include "vkdevice.h"
+#include "vkbuffer.h"
+#include "vktexture.h"
+#include "vksampler.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace swarm
+{
+    static VkDescriptorPool CreatePoolBlock(Device_T *device, const DescriptorPool_T *pool)
+    {
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = pool->maxSets;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(pool->poolSizes.size());
+        poolInfo.pPoolSizes = pool->poolSizes.data();
+
+        VkDescriptorPool block{VK_NULL_HANDLE};
+        if (vkCreateDescriptorPool(device->device, &poolInfo, GetHostAllocator(), &block) != VK_SUCCESS)
+            return VK_NULL_HANDLE;
+
+        return block;
+    }
+
+    static void ReleaseSets(DescriptorPool_T *pool)
+    {
+        for (DescriptorSet_T *set : pool->sets)
+            SWARM_DELETE(set);
+        pool->sets.clear();
+    }
+
+    DescriptorPoolHandle CreateDescriptorPool(DeviceHandle device, const DescriptorPoolCreateInfo &createInfo)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(createInfo.layouts && createInfo.layoutCount > 0);
+        assert(createInfo.setsPerLayout > 0);
+
+        DescriptorPoolHandle handle = SWARM_NEW<DescriptorPool_T>();
+        handle->maxSets = createInfo.layoutCount * createInfo.setsPerLayout;
+
+        for (unsigned int i = 0; i < createInfo.layoutCount; i++)
+        {
+            for (const VkDescriptorSetLayoutBinding &binding : createInfo.layouts[i]->bindings)
+            {
+                const uint32_t descriptorCount = binding.descriptorCount * createInfo.setsPerLayout;
+
+                auto it = std::find_if(handle->poolSizes.begin(), handle->poolSizes.end(),
+                                       [&](const VkDescriptorPoolSize &size) { return size.type == binding.descriptorType; });
+                if (it != handle->poolSizes.end())
+                    it->descriptorCount += descriptorCount;
+                else
+                    handle->poolSizes.push_back({binding.descriptorType, descriptorCount});
+            }
+        }
+
+        VkDescriptorPool block = CreatePoolBlock(device, handle);
+        if (block == VK_NULL_HANDLE)
+        {
+            SWARM_DELETE(handle);
+            return nullptr;
+        }
+
+        handle->blocks.push_back(block);
+        return handle;
+    }
+
+    void DestroyDescriptorPool(DeviceHandle device, DescriptorPoolHandle &handle)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(handle));
+
+        DescriptorPoolHandle pool = handle;
+        RetireHandle(pool);
+        for (DescriptorSet_T *set : pool->sets)
+            RetireHandle(set);
+        DestroyDeferred(device, [device, pool]()
+        {
+            for (VkDescriptorPool block : pool->blocks)
+                vkDestroyDescriptorPool(device->device, block, GetHostAllocator());
+
+            ReleaseSets(pool);
+            SWARM_DELETE(pool);
+        });
+    }
+
+    void ResetDescriptorPool(DeviceHandle device, DescriptorPoolHandle pool)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(pool));
+
+        // Blocks stay allocated, a frame that needed them once is likely to need them again
+        for (size_t i = 0; i <= pool->currentBlock && i < pool->blocks.size(); i++)
+            vkResetDescriptorPool(device->device, pool->blocks[i], 0);
+
+        pool->currentBlock = 0;
+        ReleaseSets(pool);
+    }
+
+    bool AllocateDescriptorSets(DeviceHandle device, DescriptorPoolHandle pool, const DescriptorSetlayoutHandle *layouts,
+                                unsigned int count, DescriptorSetHandle *sets)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(pool));
+        assert(layouts && sets);
+        assert(std::none_of(layouts, layouts + count,
+                            [](const DescriptorSetlayout_T *layout) { return layout->isPushDescriptor; }));
+
+        std::vector<VkDescriptorSetLayout> setLayouts(count);
+        for (unsigned int i = 0; i < count; i++)
+            setLayouts[i] = layouts[i]->setLayout;
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorSetCount = count;
+        allocInfo.pSetLayouts = setLayouts.data();
+
+        std::vector<VkDescriptorSet> descriptorSets(count);
+        bool isFreshBlock = false;
+        for (;;)
+        {
+            allocInfo.descriptorPool = pool->blocks[pool->currentBlock];
+
+            VkResult result = vkAllocateDescriptorSets(device->device, &allocInfo, descriptorSets.data());
+            if (result == VK_SUCCESS)
+                break;
+
+            // A request that doesn't fit in an empty block never will
+            if ((result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) || isFreshBlock)
+                return false;
+
+            if (pool->currentBlock + 1 == pool->blocks.size())
+            {
+                VkDescriptorPool block = CreatePoolBlock(device, pool);
+                if (block == VK_NULL_HANDLE)
+                    return false;
+
+                pool->blocks.push_back(block);
+                isFreshBlock = true;
+            }
+            pool->currentBlock++;
+        }
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            DescriptorSetHandle set = SWARM_NEW<DescriptorSet_T>();
+            set->set = descriptorSets[i];
+            set->layout = layouts[i];
+            pool->sets.push_back(set);
+            sets[i] = set;
+        }
+
+        return true;
+    }
+
+    static VkImageLayout GetDescriptorImageLayout(VkDescriptorType type)
+    {
+        return type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    static VkDeviceSize GetMaxBufferRange(const Device_T *device, VkDescriptorType type)
+    {
+        const VkPhysicalDeviceLimits &limits = device->capabilityCache.properties.limits;
+        const bool isUniform =
+            type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        return isUniform ? limits.maxUniformBufferRange : limits.maxStorageBufferRange;
+    }
+
+    void BuildDescriptorWrites(const Device_T *device, const DescriptorWrite *writes, unsigned int writeCount,
+                               const DescriptorSetlayout_T *pushDescriptorLayout, DescriptorWriteBatch &batch)
+    {
+        // Reserved up front, the write structs point into these arrays
+        size_t descriptorCount = 0;
+        for (unsigned int i = 0; i < writeCount; i++)
+            descriptorCount += writes[i].count;
+
+        batch.bufferInfos.clear();
+        batch.imageInfos.clear();
+        batch.bufferInfos.reserve(descriptorCount);
+        batch.imageInfos.reserve(descriptorCount);
+
+        batch.writes.assign(writeCount, VkWriteDescriptorSet{});
+        for (unsigned int i = 0; i < writeCount; i++)
+        {
+            const DescriptorWrite &write = writes[i];
+            const DescriptorSetlayout_T *layout = pushDescriptorLayout;
+            if (!layout)
+            {
+                assert(IsHandleAlive(write.set));
+                assert(IsHandleAlive(write.set->layout) && "the layout of a set must outlive its updates");
+                layout = write.set->layout;
+            }
+
+            const VkDescriptorSetLayoutBinding *binding = FindLayoutBinding(layout, write.binding);
+            assert(binding && "binding missing from the layout of the set");
+            assert(write.arrayElement + write.count <= binding->descriptorCount);
+
+            VkWriteDescriptorSet &descriptorWrite = batch.writes[i];
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = pushDescriptorLayout ? VK_NULL_HANDLE : write.set->set;
+            descriptorWrite.dstBinding = write.binding;
+            descriptorWrite.dstArrayElement = write.arrayElement;
+            descriptorWrite.descriptorCount = write.count;
+            descriptorWrite.descriptorType = binding->descriptorType;
+
+            if (IsBufferDescriptor(binding->descriptorType))
+            {
+                assert(write.buffers);
+                descriptorWrite.pBufferInfo = batch.bufferInfos.data() + batch.bufferInfos.size();
+
+                // Dynamic offsets are added on bind, a range up to the end of the buffer would always overflow it
+                const bool isDynamic = IsDynamicDescriptor(binding->descriptorType);
+                const VkDeviceSize maxRange = GetMaxBufferRange(device, binding->descriptorType);
+
+                for (unsigned int j = 0; j < write.count; j++)
+                {
+                    const DescriptorBufferInfo &info = write.buffers[j];
+                    assert(IsHandleAlive(info.buffer) && info.offset < info.buffer->size);
+                    assert((info.range || !isDynamic) && "dynamic descriptors need an explicit range");
+                    assert(info.range <= maxRange && info.offset + info.range <= info.buffer->size);
+
+                    VkDescriptorBufferInfo &bufferInfo = batch.bufferInfos.emplace_back();
+                    bufferInfo.buffer = info.buffer->buffer;
+                    bufferInfo.offset = info.buffer->offset + info.offset;
+                    bufferInfo.range = info.range ? info.range
+                                                  : std::min<VkDeviceSize>(info.buffer->size - info.offset, maxRange);
+                }
+            } else
+            {
+                assert(write.images);
+                descriptorWrite.pImageInfo = batch.imageInfos.data() + batch.imageInfos.size();
+
+                for (unsigned int j = 0; j < write.count; j++)
+                {
+                    const DescriptorImageInfo &info = write.images[j];
+                    assert(!info.texture || IsHandleAlive(info.texture));
+                    assert(!info.sampler || IsHandleAlive(info.sampler));
+
+                    VkDescriptorImageInfo &imageInfo = batch.imageInfos.emplace_back();
+                    imageInfo.sampler = info.sampler ? info.sampler->sampler : VK_NULL_HANDLE;
+                    imageInfo.imageView = info.texture ? info.texture->imageView : VK_NULL_HANDLE;
+                    imageInfo.imageLayout = GetDescriptorImageLayout(binding->descriptorType);
+                }
+            }
+        }
+    }
+
+    void UpdateDescriptorSets(DeviceHandle device, const DescriptorWrite *writes, unsigned int writeCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(writes || writeCount == 0);
+
+        DescriptorWriteBatch batch;
+        BuildDescriptorWrites(device, writes, writeCount, nullptr, batch);
+
+        vkUpdateDescriptorSets(device->device, writeCount, batch.writes.data(), 0, nullptr);
+    }
+}
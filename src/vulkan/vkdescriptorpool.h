@@ -0,0 +1,55 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+#include <vector>
+namespace swarm
+{
+    struct DescriptorSetKey;
+
+    struct DescriptorSet_T
+    {
+        VkDescriptorSet set{VK_NULL_HANDLE};
+        DescriptorSetlayoutHandle layout{nullptr};
+
+        // Cached sets only, the block they are freed back to and their entry in the layout cache
+        VkDescriptorPool block{VK_NULL_HANDLE};
+        const DescriptorSetKey *cacheKey{nullptr};
+    };
+
+    // Chain of VkDescriptorPool blocks of the same size, allocation moves to the next one when a block is full
+    struct DescriptorPool_T
+    {
+        std::vector<VkDescriptorPool> blocks;
+        size_t currentBlock{0};
+
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        uint32_t maxSets{0};
+
+        std::vector<DescriptorSet_T*> sets; //Handed out since the last reset
+    };
+
+    // Vulkan writes with the info arrays they point into
+    struct DescriptorWriteBatch
+    {
+        std::vector<VkWriteDescriptorSet> writes;
+        std::vector<VkDescriptorBufferInfo> bufferInfos;
+        std::vector<VkDescriptorImageInfo> imageInfos;
+    };
+
+    // Bindings resolve in `pushDescriptorLayout` when given and the sets of the writes are ignored,
+    // otherwise in the layout of each write's set
+    void BuildDescriptorWrites(const Device_T *device, const DescriptorWrite *writes, unsigned int writeCount,
+                               const DescriptorSetlayout_T *pushDescriptorLayout, DescriptorWriteBatch &batch);
+
+    inline bool IsBufferDescriptor(VkDescriptorType type)
+    {
+        return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+               type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    }
+
+    inline bool IsDynamicDescriptor(VkDescriptorType type)
+    {
+        return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    }
+}
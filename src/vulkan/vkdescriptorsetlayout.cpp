@@ -1,8 +1,10 @@
 #include "vkdescriptorsetlayout.h"
 #include "vkdevice.h"
 #include "swarm_internal.h"
+#include "vkdescriptorcache.h"
 
 
+#include <algorithm>
 #include <cassert>
 #include <vulkan/vulkan_core.h>
 
@@ -15,8 +17,20 @@ namespace swarm
         {
             case BindingType::UBO:
                 return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            case BindingType::UBO_DYNAMIC:
+                return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
             case BindingType::IMAGE_SAMPLER:
                 return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            case BindingType::STORAGE:
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            case BindingType::STORAGE_DYNAMIC:
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+            case BindingType::SAMPLED_IMAGE:
+                return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+            case BindingType::SAMPLER:
+                return VK_DESCRIPTOR_TYPE_SAMPLER;
+            case BindingType::STORAGE_IMAGE:
+                return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
             default:
                 return VK_DESCRIPTOR_TYPE_MAX_ENUM;
         }
@@ -30,51 +44,97 @@ namespace swarm
                 return VK_SHADER_STAGE_VERTEX_BIT;
             case ShaderStage::FRAGMENT:
                 return VK_SHADER_STAGE_FRAGMENT_BIT;
+            case ShaderStage::COMPUTE:
+                return VK_SHADER_STAGE_COMPUTE_BIT;
             default:
                 return VK_SHADER_STAGE_FLAG_BITS_MAX_ENUM;
         }
     }
 
 
-    DescriptorSetlayoutHandle CreateDescriptorSetlayout(DeviceHandle device, DescriptorSetLayoutBinding *bindings,
-        unsigned int bindingCount)
+    static DescriptorSetlayoutHandle CreateLayout(Device_T *device, const DescriptorSetLayoutBinding *bindings,
+                                                  unsigned int bindingCount, VkDescriptorSetLayoutCreateFlags flags)
     {
-        assert(g_SwarmLibrary.isInitialized);
-        assert(device);
-
         std::vector<VkDescriptorSetLayoutBinding> vkBindings(bindingCount);
         for (unsigned int i = 0; i < bindingCount; i++)
         {
             vkBindings[i].binding = bindings[i].position;
             vkBindings[i].descriptorType = GetDescriptorType(bindings[i].type);
-            vkBindings[i].descriptorCount = 1;
+            vkBindings[i].descriptorCount = std::max(bindings[i].count, 1u);
             vkBindings[i].stageFlags = GetShaderStageFlags(bindings[i].stage);
         }
 
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.flags = flags;
         layoutInfo.bindingCount = static_cast<uint32_t>(vkBindings.size());
         layoutInfo.pBindings = vkBindings.data();
 
         VkDescriptorSetLayout setLayout;
-        if (vkCreateDescriptorSetLayout(device->device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+        if (vkCreateDescriptorSetLayout(device->device, &layoutInfo, GetHostAllocator(), &setLayout) != VK_SUCCESS)
         {
             return nullptr;
         }
 
         DescriptorSetlayoutHandle handle = SWARM_NEW<DescriptorSetlayout_T>();
         handle->setLayout = setLayout;
+        handle->bindings = std::move(vkBindings);
+        handle->isPushDescriptor = (flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) != 0;
+        for (const VkDescriptorSetLayoutBinding &binding : handle->bindings)
+        {
+            if (binding.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
+                binding.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC)
+                handle->dynamicDescriptorCount += binding.descriptorCount;
+        }
         return handle;
     }
 
+    DescriptorSetlayoutHandle CreateDescriptorSetlayout(DeviceHandle device, DescriptorSetLayoutBinding *bindings,
+        unsigned int bindingCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        return CreateLayout(device, bindings, bindingCount, 0);
+    }
+
+    DescriptorSetlayoutHandle CreatePushDescriptorSetlayout(DeviceHandle device, DescriptorSetLayoutBinding *bindings,
+                                                            unsigned int bindingCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        if (!device->capabilities.pushDescriptors)
+            return nullptr;
+
+        // Push descriptor layouts cannot hold dynamic descriptors, offsets go in the pushed range instead
+        unsigned int descriptorCount = 0;
+        for (unsigned int i = 0; i < bindingCount; i++)
+        {
+            if (bindings[i].type == BindingType::UBO_DYNAMIC || bindings[i].type == BindingType::STORAGE_DYNAMIC)
+                return nullptr;
+            descriptorCount += std::max(bindings[i].count, 1u);
+        }
+        if (descriptorCount > device->capabilities.maxPushDescriptors)
+            return nullptr;
+
+        return CreateLayout(device, bindings, bindingCount, VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR);
+    }
+
     void DestroyDescriptorSetlayout(DeviceHandle device, DescriptorSetlayoutHandle &handle)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vkDestroyDescriptorSetLayout(device->device, handle->setLayout, nullptr);
+        DescriptorSetlayoutHandle setLayout = handle;
+        RetireHandle(setLayout);
+        DestroyDescriptorSetCache(device, setLayout);
+        DestroyDeferred(device, [device, setLayout]()
+        {
+            vkDestroyDescriptorSetLayout(device->device, setLayout->setLayout, GetHostAllocator());
 
-        SWARM_DELETE(handle);
+            SWARM_DELETE(setLayout);
+        });
     }
 }
@@ -6,6 +6,8 @@
 #include <vector>
 namespace swarm
 {
+    struct DescriptorSetCache;
+
     struct DescriptorSetLayoutBuilder_T
     {
         std::vector<VkDescriptorSetLayoutBinding> bindings;
@@ -14,5 +16,22 @@ namespace swarm
     struct DescriptorSetlayout_T
     {
         VkDescriptorSetLayout setLayout;
+        std::vector<VkDescriptorSetLayoutBinding> bindings; //Sizes pools and resolves descriptor writes
+        DescriptorSetCache *setCache{nullptr}; //Created by the first GetCachedDescriptorSet on the layout
+        bool isPushDescriptor{false}; //Never allocated, written by CmdPushDescriptorSet
+        uint32_t dynamicDescriptorCount{0}; //Dynamic offsets a set of this layout takes when bound
     };
+
+    VkDescriptorType GetDescriptorType(BindingType type);
+    VkShaderStageFlags GetShaderStageFlags(ShaderStage stage);
+
+    inline const VkDescriptorSetLayoutBinding *FindLayoutBinding(const DescriptorSetlayout_T *layout, uint32_t binding)
+    {
+        for (const VkDescriptorSetLayoutBinding &layoutBinding : layout->bindings)
+        {
+            if (layoutBinding.binding == binding)
+                return &layoutBinding;
+        }
+        return nullptr;
+    }
 }
@@ -2,17 +2,150 @@
 
 #include "vkinstance.h"
 #include "vksurface.h"
+#include "vksynchronisation.h"
 
 #include <vk_mem_alloc.h>
+
+#include <cstring>
 namespace swarm
 {
+    static void FillDeviceCapabilities(Device_T *device)
+    {
+        const VkPhysicalDeviceProperties &properties = device->capabilityCache.properties;
+        const VkPhysicalDeviceLimits &limits = properties.limits;
+        const VkPhysicalDeviceFeatures &features = device->capabilityCache.features;
+        const VkPhysicalDeviceMemoryProperties &memory = device->capabilityCache.memoryProperties;
+
+        DeviceCapabilities &capabilities = device->capabilities;
+        capabilities = {};
+
+        strncpy(capabilities.deviceName, properties.deviceName, sizeof(capabilities.deviceName) - 1);
+        capabilities.vendorID = properties.vendorID;
+        capabilities.deviceID = properties.deviceID;
+        capabilities.apiVersion = properties.apiVersion;
+        capabilities.isDiscreteGPU = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+
+        capabilities.maxImageDimension2D = limits.maxImageDimension2D;
+        capabilities.maxImageArrayLayers = limits.maxImageArrayLayers;
+        capabilities.maxUniformBufferRange = limits.maxUniformBufferRange;
+        capabilities.maxStorageBufferRange = limits.maxStorageBufferRange;
+        capabilities.maxPushConstantsSize = limits.maxPushConstantsSize;
+        capabilities.maxBoundDescriptorSets = limits.maxBoundDescriptorSets;
+        capabilities.maxVertexInputAttributes = limits.maxVertexInputAttributes;
+        capabilities.maxVertexInputBindings = limits.maxVertexInputBindings;
+        capabilities.maxColorAttachments = limits.maxColorAttachments;
+        for (int i = 0; i < 3; i++)
+        {
+            capabilities.maxComputeWorkGroupCount[i] = limits.maxComputeWorkGroupCount[i];
+            capabilities.maxComputeWorkGroupSize[i] = limits.maxComputeWorkGroupSize[i];
+        }
+        capabilities.maxComputeWorkGroupInvocations = limits.maxComputeWorkGroupInvocations;
+        capabilities.minUniformBufferOffsetAlignment = limits.minUniformBufferOffsetAlignment;
+        capabilities.minStorageBufferOffsetAlignment = limits.minStorageBufferOffsetAlignment;
+        capabilities.maxSamplerAnisotropy = limits.maxSamplerAnisotropy;
+        capabilities.timestampPeriod = limits.timestampPeriod;
+
+        capabilities.samplerAnisotropy = features.samplerAnisotropy;
+        capabilities.multiDrawIndirect = features.multiDrawIndirect;
+        capabilities.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
+        capabilities.textureCompressionBC = features.textureCompressionBC;
+
+        for (uint32_t i = 0; i < memory.memoryHeapCount; i++)
+        {
+            if (memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+                capabilities.deviceLocalMemorySize += memory.memoryHeaps[i].size;
+        }
+
+        const VkMemoryPropertyFlags hostVisibleDeviceLocal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        for (uint32_t i = 0; i < memory.memoryTypeCount; i++)
+        {
+            if ((memory.memoryTypes[i].propertyFlags & hostVisibleDeviceLocal) == hostVisibleDeviceLocal)
+                capabilities.hasHostVisibleDeviceLocalMemory = true;
+        }
+
+        capabilities.extendedDynamicState = device->dynamicState.setCullMode != nullptr;
+        capabilities.dynamicBlendEnable = device->dynamicState.setColorBlendEnable != nullptr;
+
+        capabilities.hasTransferQueue = HasSeparateUploadQueue(device);
+        capabilities.hasAsyncComputeQueue = device->computeQueue != VK_NULL_HANDLE;
+    }
+
+    template<typename T>
+    static T LoadDeviceFunction(VkDevice device, const char *name)
+    {
+        return reinterpret_cast<T>(vkGetDeviceProcAddr(device, name));
+    }
+
+    static void LoadDynamicStateFunctions(Device_T *device, bool hasExtendedDynamicState, bool hasDynamicBlendEnable)
+    {
+        DynamicStateFunctions &functions = device->dynamicState;
+        VkDevice vkDevice = device->device.device;
+
+        if (hasExtendedDynamicState)
+        {
+            functions.setCullMode = LoadDeviceFunction<PFN_vkCmdSetCullModeEXT>(vkDevice, "vkCmdSetCullModeEXT");
+            functions.setFrontFace = LoadDeviceFunction<PFN_vkCmdSetFrontFaceEXT>(vkDevice, "vkCmdSetFrontFaceEXT");
+            functions.setPrimitiveTopology = LoadDeviceFunction<PFN_vkCmdSetPrimitiveTopologyEXT>(vkDevice, "vkCmdSetPrimitiveTopologyEXT");
+            functions.setDepthTestEnable = LoadDeviceFunction<PFN_vkCmdSetDepthTestEnableEXT>(vkDevice, "vkCmdSetDepthTestEnableEXT");
+            functions.setDepthWriteEnable = LoadDeviceFunction<PFN_vkCmdSetDepthWriteEnableEXT>(vkDevice, "vkCmdSetDepthWriteEnableEXT");
+            functions.setDepthCompareOp = LoadDeviceFunction<PFN_vkCmdSetDepthCompareOpEXT>(vkDevice, "vkCmdSetDepthCompareOpEXT");
+
+            // All or nothing, pipelines rely on every one of them
+            if (!functions.setCullMode || !functions.setFrontFace || !functions.setPrimitiveTopology ||
+                !functions.setDepthTestEnable || !functions.setDepthWriteEnable || !functions.setDepthCompareOp)
+                functions = {};
+        }
+
+        if (functions.setCullMode && hasDynamicBlendEnable)
+            functions.setColorBlendEnable = LoadDeviceFunction<PFN_vkCmdSetColorBlendEnableEXT>(vkDevice, "vkCmdSetColorBlendEnableEXT");
+    }
+
+    static void LoadPushDescriptorFunction(Device_T *device, VkPhysicalDevice physicalDevice)
+    {
+        device->cmdPushDescriptorSet = LoadDeviceFunction<PFN_vkCmdPushDescriptorSetKHR>(device->device.device, "vkCmdPushDescriptorSetKHR");
+        if (!device->cmdPushDescriptorSet)
+            return;
+
+        VkPhysicalDevicePushDescriptorPropertiesKHR pushDescriptorProperties{};
+        pushDescriptorProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+
+        VkPhysicalDeviceProperties2 properties{};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &pushDescriptorProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+        device->capabilities.pushDescriptors = true;
+        device->capabilities.maxPushDescriptors = pushDescriptorProperties.maxPushDescriptors;
+    }
+
     DeviceHandle CreateDevice(InstanceHandle instance, SurfaceHandle surface, const DeviceCreateInfo &deviceCreateInfo)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(instance);
 
         vkb::PhysicalDeviceSelector deviceSelector{instance->instance};
-        deviceSelector.set_surface(surface->surface);
+        if (surface)
+            deviceSelector.set_surface(surface->surface);
+        else
+            deviceSelector.require_present(false);
+        deviceSelector.set_minimum_version(1, 2);
+
+        VkPhysicalDeviceVulkan12Features features12{};
+        features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        features12.timelineSemaphore = VK_TRUE;
+        if (deviceCreateInfo.enableBindless)
+        {
+            features12.descriptorIndexing = VK_TRUE;
+            features12.runtimeDescriptorArray = VK_TRUE;
+            features12.descriptorBindingPartiallyBound = VK_TRUE;
+            features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            features12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        }
+        deviceSelector.set_required_features_12(features12);
 
         if (deviceCreateInfo.isDiscreteGPURequired)
             deviceSelector.prefer_gpu_device_type(vkb::PreferredDeviceType::discrete);
@@ -28,7 +161,26 @@ namespace swarm
         deviceFeatures.samplerAnisotropy = VK_TRUE;
         physicalDevice.enable_features_if_present(deviceFeatures);
 
+        const bool hasCreationFeedback = physicalDevice.enable_extension_if_present(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+        const bool hasPushDescriptor = physicalDevice.enable_extension_if_present(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+
+        // Optional, PipelineCreateInfo::useDynamicState falls back to static state without them
+        VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures{};
+        extendedDynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+        extendedDynamicStateFeatures.extendedDynamicState = VK_TRUE;
+        const bool hasExtendedDynamicState =
+                physicalDevice.enable_extension_if_present(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME) &&
+                physicalDevice.enable_extension_features_if_present(extendedDynamicStateFeatures);
+
+        VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features{};
+        extendedDynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+        extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable = VK_TRUE;
+        const bool hasDynamicBlendEnable =
+                physicalDevice.enable_extension_if_present(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) &&
+                physicalDevice.enable_extension_features_if_present(extendedDynamicState3Features);
+
         vkb::DeviceBuilder deviceBuilder{physicalDevice};
+        deviceBuilder.set_allocation_callbacks(GetHostAllocator());
 
         const auto deviceResult = deviceBuilder.build();
 
@@ -39,6 +191,7 @@ namespace swarm
         allocatorInfo.physicalDevice = physicalDevice.physical_device;
         allocatorInfo.device = deviceResult.value().device;
         allocatorInfo.instance = instance->instance;
+        allocatorInfo.pAllocationCallbacks = GetHostAllocator();
 
         VmaAllocator allocator;
         if(vmaCreateAllocator(&allocatorInfo, &allocator) != VK_SUCCESS)
@@ -48,16 +201,110 @@ namespace swarm
         DeviceHandle handle = SWARM_NEW<Device_T>();
         handle->device = deviceResult.value();
         handle->allocator = allocator;
+        handle->bufferBlockSize = deviceCreateInfo.bufferBlockSize;
+        handle->deferredDestruction = deviceCreateInfo.deferredDestruction;
+        handle->pipelineWorkerCount = deviceCreateInfo.pipelineWorkerCount;
+
+        const uint32_t graphicsFamily = handle->device.get_queue_index(vkb::QueueType::graphics).value();
+        handle->graphicsQueue = handle->device.get_queue(vkb::QueueType::graphics).value();
+        handle->graphicsQueueFamily = graphicsFamily;
+        handle->uploadQueue = handle->graphicsQueue;
+        handle->uploadQueueFamily = graphicsFamily;
+        handle->queueFamilies = {graphicsFamily};
+
+        if (deviceCreateInfo.useTransferQueue)
+        {
+            // vk-bootstrap creates a queue in every family, prefer one that does nothing but transfers
+            auto transferFamily = handle->device.get_dedicated_queue_index(vkb::QueueType::transfer);
+            auto transferQueue = handle->device.get_dedicated_queue(vkb::QueueType::transfer);
+            if (!transferFamily.has_value() || !transferQueue.has_value())
+            {
+                transferFamily = handle->device.get_queue_index(vkb::QueueType::transfer);
+                transferQueue = handle->device.get_queue(vkb::QueueType::transfer);
+            }
+
+            if (transferFamily.has_value() && transferQueue.has_value() && transferFamily.value() != graphicsFamily)
+            {
+                handle->uploadQueue = transferQueue.value();
+                handle->uploadQueueFamily = transferFamily.value();
+                handle->queueFamilies.push_back(transferFamily.value());
+            }
+        }
 
+        if (deviceCreateInfo.useAsyncComputeQueue)
+        {
+            auto computeFamily = handle->device.get_dedicated_queue_index(vkb::QueueType::compute);
+            auto computeQueue = handle->device.get_dedicated_queue(vkb::QueueType::compute);
+            if (!computeFamily.has_value() || !computeQueue.has_value())
+            {
+                computeFamily = handle->device.get_queue_index(vkb::QueueType::compute);
+                computeQueue = handle->device.get_queue(vkb::QueueType::compute);
+            }
 
+            if (computeFamily.has_value() && computeQueue.has_value() && computeFamily.value() != graphicsFamily)
+            {
+                handle->computeQueue = computeQueue.value();
+                handle->computeQueueFamily = computeFamily.value();
+
+                // The transfer queue may already live in the same family
+                if (computeFamily.value() != handle->uploadQueueFamily)
+                    handle->queueFamilies.push_back(computeFamily.value());
+            }
+        }
+
+        LoadDynamicStateFunctions(handle, hasExtendedDynamicState, hasDynamicBlendEnable);
+        CacheDeviceCapabilities(physicalDevice.physical_device, handle->capabilityCache);
+        FillDeviceCapabilities(handle);
+        if (hasPushDescriptor)
+            LoadPushDescriptorFunction(handle, physicalDevice.physical_device);
+
+        // Pipelines can still be created without a cache, a failure here only costs compile time
+        handle->pipelineCache.hasCreationFeedback = hasCreationFeedback;
+        CreatePipelineCache(handle, deviceCreateInfo.pipelineCacheData, deviceCreateInfo.pipelineCacheSize, handle->pipelineCache);
+
+        handle->submissionTimeline = CreateTimelineSemaphore(handle, 0);
+        if (handle->computeQueue != VK_NULL_HANDLE)
+            handle->computeTimeline = CreateTimelineSemaphore(handle, 0);
+
+        if (handle->submissionTimeline == VK_NULL_HANDLE ||
+            (handle->computeQueue != VK_NULL_HANDLE && handle->computeTimeline == VK_NULL_HANDLE) ||
+            !CreateStagingRing(handle, deviceCreateInfo.stagingBufferSize, handle->stagingRing) ||
+            !CreateUploadContext(handle, handle->uploadContext) ||
+            (deviceCreateInfo.enableBindless &&
+             !CreateBindlessHeap(handle, physicalDevice.physical_device, deviceCreateInfo, handle->bindlessHeap)))
+        {
+            DestroyBindlessHeap(handle, handle->bindlessHeap);
+            DestroyUploadContext(handle, handle->uploadContext);
+            DestroyPipelineCache(handle, handle->pipelineCache);
+            vkDestroySemaphore(handle->device, handle->submissionTimeline, GetHostAllocator());
+            vkDestroySemaphore(handle->device, handle->computeTimeline, GetHostAllocator());
+            DestroyStagingRing(handle, handle->stagingRing);
+            vmaDestroyAllocator(allocator);
+            vkb::destroy_device(handle->device);
+            SWARM_DELETE(handle);
+            return nullptr;
+        }
+
+        handle->capabilities.bindless = IsBindlessEnabled(handle->bindlessHeap);
         return handle;
     }
 
     void DestroyDevice(DeviceHandle &handle)
     {
         assert(g_SwarmLibrary.isInitialized);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
+        // Pending compilations still go through the cache
+        handle->pipelineWorkers.Stop();
+        CollectDeferredReleases(handle, true);
+
+        DestroyPipelineCache(handle, handle->pipelineCache);
+        DestroyBindlessHeap(handle, handle->bindlessHeap);
+        DestroyUploadContext(handle, handle->uploadContext);
+        vkDestroySemaphore(handle->device, handle->submissionTimeline, GetHostAllocator());
+        vkDestroySemaphore(handle->device, handle->computeTimeline, GetHostAllocator());
+        DestroyStagingRing(handle, handle->stagingRing);
+        DestroyBufferBlocks(handle);
         vmaDestroyAllocator(handle->allocator);
         vkb::destroy_device(handle->device);
 
@@ -69,5 +316,87 @@ namespace swarm
         vkDeviceWaitIdle(device->device);
     }
 
+    const DeviceCapabilities &GetDeviceCapabilities(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        return device->capabilities;
+    }
+
+    void CollectDestroyedObjects(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        CollectDeferredReleases(device, false);
+    }
+
+    void DestroyDeferred(Device_T *device, std::function<void()> &&release)
+    {
+        if (!device->deferredDestruction)
+        {
+            release();
+            return;
+        }
+
+        // Commands recorded but not submitted yet may still use the object, so wait for the next submission on
+        // each queue. The compute queue is only waited on once used, or graphics-only apps would never release.
+        // Likewise an open upload batch is covered by the serial it will be submitted with.
+        const UploadContext &uploads = device->uploadContext;
+
+        std::lock_guard lock(device->releaseMutex);
+
+        DeferredRelease deferred{};
+        deferred.submissionValue = device->submissionValue + 1;
+        if (device->computeSubmissionValue > 0)
+            deferred.computeValue = device->computeSubmissionValue + 1;
+        deferred.uploadSerial = uploads.recording.commandBuffer != VK_NULL_HANDLE ? uploads.recording.serial
+                                                                                  : uploads.submittedSerial;
+        deferred.release = std::move(release);
+        device->releaseQueue.push_back(std::move(deferred));
+    }
+
+    void CollectDeferredReleases(Device_T *device, bool waitAll)
+    {
+        {
+            std::lock_guard lock(device->releaseMutex);
+            if (device->releaseQueue.empty())
+                return;
+        }
+
+        if (waitAll)
+            vkDeviceWaitIdle(device->device);
+
+        uint64_t completedValue = 0;
+        vkGetSemaphoreCounterValue(device->device, device->submissionTimeline, &completedValue);
+        uint64_t completedComputeValue = 0;
+        if (device->computeTimeline != VK_NULL_HANDLE)
+            vkGetSemaphoreCounterValue(device->device, device->computeTimeline, &completedComputeValue);
+        UploadPoll(device);
+
+        // Run outside of the lock so that it never nests with the locks the releases take
+        std::vector<std::function<void()>> releases;
+        {
+            std::lock_guard lock(device->releaseMutex);
+
+            // Values only grow along the queue, stop at the first entry the GPU may still be using
+            while (!device->releaseQueue.empty())
+            {
+                DeferredRelease &deferred = device->releaseQueue.front();
+                if (!waitAll && (deferred.submissionValue > completedValue ||
+                                 deferred.computeValue > completedComputeValue ||
+                                 deferred.uploadSerial > device->uploadContext.completedSerial))
+                    break;
+
+                releases.push_back(std::move(deferred.release));
+                device->releaseQueue.pop_front();
+            }
+        }
+
+        for (std::function<void()> &release : releases)
+            release();
+    }
+
 
 }
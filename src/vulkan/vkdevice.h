@@ -1,13 +1,138 @@
 #pragma once
 #include <swarm_internal.h>
+#include <workerpool.h>
 
 #include <VkBootstrap.h>
 #include <vk_mem_alloc.h>
+
+#include "vkbindless.h"
+#include "vkbuffer.h"
+#include "vkcapabilities.h"
+#include "vkhostallocator.h"
+#include "vkpipeline.h"
+#include "vkpipelinecache.h"
+#include "vkstaging.h"
+#include "vkupload.h"
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
 namespace swarm
 {
+    struct DescriptorSet_T;
+
+    // Destruction of an object the GPU may still use, run once every timeline went past the recorded values
+    struct DeferredRelease
+    {
+        uint64_t submissionValue{0};
+        uint64_t computeValue{0};
+        uint64_t uploadSerial{0};
+        std::function<void()> release;
+    };
+
+    // Entry points of VK_EXT_extended_dynamic_state and _3, null when the extension or feature is missing
+    struct DynamicStateFunctions
+    {
+        PFN_vkCmdSetCullModeEXT setCullMode{nullptr};
+        PFN_vkCmdSetFrontFaceEXT setFrontFace{nullptr};
+        PFN_vkCmdSetPrimitiveTopologyEXT setPrimitiveTopology{nullptr};
+        PFN_vkCmdSetDepthTestEnableEXT setDepthTestEnable{nullptr};
+        PFN_vkCmdSetDepthWriteEnableEXT setDepthWriteEnable{nullptr};
+        PFN_vkCmdSetDepthCompareOpEXT setDepthCompareOp{nullptr};
+        PFN_vkCmdSetColorBlendEnableEXT setColorBlendEnable{nullptr};
+    };
+
     struct Device_T
     {
         vkb::Device device;
         VmaAllocator allocator;
+
+        DeviceCapabilityCache capabilityCache;
+        DeviceCapabilities capabilities;
+        DynamicStateFunctions dynamicState;
+        PFN_vkCmdPushDescriptorSetKHR cmdPushDescriptorSet{nullptr}; //VK_KHR_push_descriptor, null without it
+
+        PipelineCache pipelineCache;
+
+        // Compiles async pipeline requests, started by the first one
+        std::mutex pipelineWorkersMutex;
+        WorkerPool pipelineWorkers;
+        unsigned int pipelineWorkerCount{0};
+
+        // Live pipelines and layouts by content, repeated create calls share them
+        std::mutex pipelineStateMutex;
+        std::unordered_map<PipelineStateKey, Pipeline_T*, PipelineStateKeyHash> pipelines;
+        std::unordered_map<PipelineLayoutKey, PipelineLayoutEntry, PipelineLayoutKeyHash> pipelineLayouts;
+
+        BindlessHeap bindlessHeap; //Empty unless DeviceCreateInfo::enableBindless
+
+        // Cached descriptor sets by the buffers, textures and samplers they reference, to evict them on destroy
+        std::mutex descriptorCacheMutex;
+        std::unordered_map<const void*, std::vector<DescriptorSet_T*>> descriptorSetUsers;
+        DescriptorSetCacheStats descriptorCacheStats;
+
+        // Blocks GPU_ONLY buffers are carved out of, the mutex also covers their virtual allocations
+        VkDeviceSize bufferBlockSize{0};
+        std::mutex bufferBlocksMutex;
+        std::vector<BufferBlock*> bufferBlocks;
+
+        StagingRing stagingRing;
+        UploadContext uploadContext;
+
+        VkQueue graphicsQueue{VK_NULL_HANDLE};
+        uint32_t graphicsQueueFamily{0};
+
+        // Queue running the upload batches, the graphics queue unless a separate transfer family is used
+        VkQueue uploadQueue{VK_NULL_HANDLE};
+        uint32_t uploadQueueFamily{0};
+
+        // Async compute queue, VK_NULL_HANDLE when compute goes to the graphics queue
+        VkQueue computeQueue{VK_NULL_HANDLE};
+        uint32_t computeQueueFamily{0};
+
+        // Families buffers and textures are shared between, a single one means exclusive ownership
+        std::vector<uint32_t> queueFamilies;
+
+        // Signaled by every graphics submission with the next value of `submissionValue`
+        VkSemaphore submissionTimeline{VK_NULL_HANDLE};
+        uint64_t submissionValue{0};
+
+        // Same for submissions to the async compute queue
+        VkSemaphore computeTimeline{VK_NULL_HANDLE};
+        uint64_t computeSubmissionValue{0};
+
+        bool deferredDestruction{false};
+
+        // Pipeline workers release layouts too. Guards the queue and the writes of the submission values and upload
+        // serials DestroyDeferred tags entries with.
+        std::mutex releaseMutex;
+        std::deque<DeferredRelease> releaseQueue;
     };
+
+    inline bool HasSeparateUploadQueue(const Device_T *device)
+    {
+        return device->uploadQueueFamily != device->graphicsQueueFamily;
+    }
+
+    // Works for both VkBufferCreateInfo and VkImageCreateInfo
+    template<typename CreateInfo>
+    void SetQueueSharing(const Device_T *device, CreateInfo &createInfo)
+    {
+        if (device->queueFamilies.size() > 1)
+        {
+            createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            createInfo.queueFamilyIndexCount = static_cast<uint32_t>(device->queueFamilies.size());
+            createInfo.pQueueFamilyIndices = device->queueFamilies.data();
+        } else
+        {
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        }
+    }
+
+    // Runs `release` right away, or queues it behind every submission made so far when destruction is deferred
+    void DestroyDeferred(Device_T *device, std::function<void()> &&release);
+
+    // Runs the queued releases the GPU is done with, all of them when `waitAll` is set
+    void CollectDeferredReleases(Device_T *device, bool waitAll);
 }
@@ -31,7 +31,7 @@ namespace swarm
             framebufferInfo.height = swapchain->swapchain.extent.height;
             framebufferInfo.layers = 1;
 
-            if (vkCreateFramebuffer(device->device, &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS)
+            if (vkCreateFramebuffer(device->device, &framebufferInfo, GetHostAllocator(), &framebuffers[i]) != VK_SUCCESS)
             {
                 return nullptr;
             }
@@ -39,20 +39,63 @@ namespace swarm
 
         FramebufferHandle handle = SWARM_NEW<Framebuffer_T>();
         handle->framebuffers = std::move(framebuffers);
+        handle->extent = swapchain->swapchain.extent;
 
         return handle;
     }
 
-    void DestroyFramebuffer(DeviceHandle device, FramebufferHandle &handle)
+    FramebufferHandle CreateOffscreenFramebuffer(DeviceHandle device, RenderpassHandle renderpass, TextureHandle colorTexture, TextureHandle depthTexture)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
+        assert(renderpass);
+        assert(colorTexture);
+        assert(depthTexture);
+        assert(colorTexture->extent.width == depthTexture->extent.width &&
+               colorTexture->extent.height == depthTexture->extent.height);
+
+        VkImageView attachments[] = {
+            colorTexture->imageView,
+            depthTexture->imageView,
+        };
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderpass->renderPass;
+        framebufferInfo.attachmentCount = 2;
+        framebufferInfo.pAttachments = attachments;
+        framebufferInfo.width = colorTexture->extent.width;
+        framebufferInfo.height = colorTexture->extent.height;
+        framebufferInfo.layers = 1;
 
-        for (auto& framebuffer : handle->framebuffers)
+        VkFramebuffer framebuffer{VK_NULL_HANDLE};
+        if (vkCreateFramebuffer(device->device, &framebufferInfo, GetHostAllocator(), &framebuffer) != VK_SUCCESS)
         {
-            vkDestroyFramebuffer(device->device, framebuffer, nullptr);
+            return nullptr;
         }
 
-        SWARM_DELETE(handle);
+        FramebufferHandle handle = SWARM_NEW<Framebuffer_T>();
+        handle->framebuffers.push_back(framebuffer);
+        handle->extent = colorTexture->extent;
+
+        return handle;
+    }
+
+    void DestroyFramebuffer(DeviceHandle device, FramebufferHandle &handle)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(handle));
+
+        FramebufferHandle framebuffers = handle;
+        RetireHandle(framebuffers);
+        DestroyDeferred(device, [device, framebuffers]()
+        {
+            for (auto& framebuffer : framebuffers->framebuffers)
+            {
+                vkDestroyFramebuffer(device->device, framebuffer, GetHostAllocator());
+            }
+
+            SWARM_DELETE(framebuffers);
+        });
     }
 }
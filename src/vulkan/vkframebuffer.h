@@ -6,6 +6,7 @@ namespace swarm
 {
     struct Framebuffer_T
     {
-        std::vector<VkFramebuffer> framebuffers;
+        std::vector<VkFramebuffer> framebuffers; //One per swapchain image, a single one offscreen
+        VkExtent2D extent{};
     };
 }
\ No newline at end of file
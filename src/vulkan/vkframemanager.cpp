@@ -0,0 +1,168 @@
+#include "vkframemanager.h"
+#include "vkdevice.h"
+#include "vksynchronisation.h"
+
+#include <cassert>
+
+namespace swarm
+{
+    FrameManagerHandle CreateFrameManager(DeviceHandle device, const FrameManagerCreateInfo &createInfo)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(createInfo.framesInFlight > 0);
+
+        FrameManagerHandle handle = SWARM_NEW<FrameManager_T>();
+        handle->device = device;
+        handle->swapchain = createInfo.swapchain;
+
+        bool isValid = true;
+        handle->frames.resize(createInfo.framesInFlight);
+        for (FrameSlot &frame: handle->frames)
+        {
+            frame.inFlightFence = CreateFence(device);
+            frame.imageAvailableSemaphore = createInfo.swapchain ? CreateSemaphore(device) : nullptr;
+            frame.commandPool = CreateCommandPool(device);
+            frame.commandBuffer = frame.commandPool ? CreateCommandBuffer(device, frame.commandPool) : nullptr;
+
+            isValid &= frame.inFlightFence && frame.commandBuffer;
+            isValid &= frame.imageAvailableSemaphore || !createInfo.swapchain;
+
+            if (createInfo.descriptorLayoutCount > 0 && createInfo.descriptorSetsPerFrame > 0)
+            {
+                DescriptorPoolCreateInfo poolInfo{};
+                poolInfo.layouts = createInfo.descriptorLayouts;
+                poolInfo.layoutCount = createInfo.descriptorLayoutCount;
+                poolInfo.setsPerLayout = createInfo.descriptorSetsPerFrame;
+                frame.descriptorPool = CreateDescriptorPool(device, poolInfo);
+
+                isValid &= frame.descriptorPool != nullptr;
+            }
+        }
+
+        // Headless frames render offscreen into image 0, nothing is acquired or presented
+        if (createInfo.swapchain)
+            handle->renderFinishedSemaphores.resize(GetSwapchainImageCount(createInfo.swapchain));
+        for (SemaphoreHandle &semaphore: handle->renderFinishedSemaphores)
+        {
+            semaphore = CreateSemaphore(device);
+            isValid &= semaphore != nullptr;
+        }
+
+        if (createInfo.transientSizePerFrame > 0)
+        {
+            TransientAllocatorCreateInfo allocatorInfo{};
+            allocatorInfo.sizePerFrame = createInfo.transientSizePerFrame;
+            allocatorInfo.frameCount = createInfo.framesInFlight;
+            allocatorInfo.usage = createInfo.transientUsage;
+            handle->transientAllocator = CreateTransientAllocator(device, allocatorInfo);
+
+            isValid &= handle->transientAllocator != nullptr;
+        }
+
+        if (!isValid)
+        {
+            DestroyFrameManager(device, handle);
+            return nullptr;
+        }
+
+        return handle;
+    }
+
+    void DestroyFrameManager(DeviceHandle device, FrameManagerHandle &handle)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(handle));
+
+        for (FrameSlot &frame: handle->frames)
+        {
+            if (frame.inFlightFence)
+            {
+                // Never destroy what the GPU may still be using
+                vkWaitForFences(device->device, 1, &frame.inFlightFence->fence, VK_TRUE, UINT64_MAX);
+                DestroyFence(device, frame.inFlightFence);
+            }
+            if (frame.imageAvailableSemaphore)
+                DestroySemaphore(device, frame.imageAvailableSemaphore);
+            if (frame.commandBuffer)
+                DestroyCommandBuffer(device, frame.commandPool, frame.commandBuffer);
+            if (frame.commandPool)
+                DestroyCommandPool(device, frame.commandPool);
+            if (frame.descriptorPool)
+                DestroyDescriptorPool(device, frame.descriptorPool);
+        }
+
+        for (SemaphoreHandle &semaphore: handle->renderFinishedSemaphores)
+        {
+            if (semaphore)
+                DestroySemaphore(device, semaphore);
+        }
+
+        if (handle->transientAllocator)
+            DestroyTransientAllocator(device, handle->transientAllocator);
+
+        SWARM_DELETE(handle);
+        handle = nullptr;
+    }
+
+    FrameInfo BeginFrame(FrameManagerHandle frameManager, RenderpassHandle renderpass, FramebufferHandle framebuffer)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(IsHandleAlive(frameManager));
+
+        FrameSlot &frame = frameManager->frames[frameManager->frameIndex];
+
+        CmdBeginFrameInfo beginInfo{};
+        beginInfo.device = frameManager->device;
+        beginInfo.inFlightFence = frame.inFlightFence;
+        beginInfo.imageAvailableSemaphore = frame.imageAvailableSemaphore;
+        beginInfo.swapchain = frameManager->swapchain;
+        beginInfo.commandBuffer = frame.commandBuffer;
+        beginInfo.renderpass = renderpass;
+        beginInfo.framebuffer = framebuffer;
+        beginInfo.transientAllocator = frameManager->transientAllocator;
+        beginInfo.descriptorPool = frame.descriptorPool;
+
+        // Only waits for the frame recorded framesInFlight frames ago, the newer ones keep running on the GPU
+        frameManager->imageIndex = CmdBeginFrame(beginInfo);
+
+        FrameInfo frameInfo{};
+        frameInfo.commandBuffer = frame.commandBuffer;
+        frameInfo.transientAllocator = frameManager->transientAllocator;
+        frameInfo.descriptorPool = frame.descriptorPool;
+        frameInfo.frameIndex = frameManager->frameIndex;
+        frameInfo.imageIndex = frameManager->imageIndex;
+        return frameInfo;
+    }
+
+    void EndFrame(FrameManagerHandle frameManager, const TimelinePoint *timelineWaits, unsigned int timelineWaitCount,
+                  const TimelinePoint *timelineSignals, unsigned int timelineSignalCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(IsHandleAlive(frameManager));
+
+        FrameSlot &frame = frameManager->frames[frameManager->frameIndex];
+
+        CmdEndFrameInfo endInfo{};
+        endInfo.commandBuffer = frame.commandBuffer;
+        CmdEndFrame(endInfo);
+
+        CmdSubmitInfo submitInfo{};
+        submitInfo.device = frameManager->device;
+        submitInfo.imageAvailableSemaphore = frame.imageAvailableSemaphore;
+        submitInfo.inFlightFence = frame.inFlightFence;
+        submitInfo.renderFinishedSemaphore = frameManager->renderFinishedSemaphores.data();
+        submitInfo.renderFinishedCount = static_cast<unsigned int>(frameManager->renderFinishedSemaphores.size());
+        submitInfo.commandBuffer = frame.commandBuffer;
+        submitInfo.swapchain = frameManager->swapchain;
+        submitInfo.imageIndex = frameManager->imageIndex;
+        submitInfo.timelineWaits = timelineWaits;
+        submitInfo.timelineWaitCount = timelineWaitCount;
+        submitInfo.timelineSignals = timelineSignals;
+        submitInfo.timelineSignalCount = timelineSignalCount;
+        CmdSubmitFrame(submitInfo);
+
+        frameManager->frameIndex = (frameManager->frameIndex + 1) % frameManager->frames.size();
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vector>
+namespace swarm
+{
+    // Everything one frame in flight needs, reused once its fence has signaled
+    struct FrameSlot
+    {
+        FenceHandle inFlightFence{nullptr};
+        SemaphoreHandle imageAvailableSemaphore{nullptr};
+        CommandPoolHandle commandPool{nullptr};
+        CommandBufferHandle commandBuffer{nullptr};
+        DescriptorPoolHandle descriptorPool{nullptr};
+    };
+
+    struct FrameManager_T
+    {
+        DeviceHandle device{nullptr};
+        SwapchainHandle swapchain{nullptr};
+
+        std::vector<FrameSlot> frames;
+        std::vector<SemaphoreHandle> renderFinishedSemaphores; // One per swapchain image
+        TransientAllocatorHandle transientAllocator{nullptr};
+
+        unsigned int frameIndex{0};
+        unsigned int imageIndex{0};
+    };
+}
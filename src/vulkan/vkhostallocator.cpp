@@ -0,0 +1,44 @@
+#include "vkhostallocator.h"
+
+namespace swarm
+{
+    static void *VKAPI_PTR HostAllocate(void *, size_t size, size_t alignment, VkSystemAllocationScope)
+    {
+        const SwarmAllocationCallbacks &callbacks = g_SwarmLibrary.allocationCallbacks;
+        return callbacks.allocFn(callbacks.userData, size, alignment);
+    }
+
+    static void *VKAPI_PTR HostReallocate(void *, void *original, size_t size, size_t alignment,
+                                          VkSystemAllocationScope)
+    {
+        const SwarmAllocationCallbacks &callbacks = g_SwarmLibrary.allocationCallbacks;
+
+        // Vulkan uses reallocation for plain allocations and frees too, the user hook only sees real resizes
+        if (!original)
+            return callbacks.allocFn(callbacks.userData, size, alignment);
+
+        if (size == 0)
+        {
+            callbacks.freeFn(callbacks.userData, original);
+            return nullptr;
+        }
+
+        return callbacks.reallocFn(callbacks.userData, original, size, alignment);
+    }
+
+    static void VKAPI_PTR HostFree(void *, void *memory)
+    {
+        if (!memory)
+            return;
+
+        const SwarmAllocationCallbacks &callbacks = g_SwarmLibrary.allocationCallbacks;
+        callbacks.freeFn(callbacks.userData, memory);
+    }
+
+    VkAllocationCallbacks *GetHostAllocator()
+    {
+        static VkAllocationCallbacks allocator{nullptr, HostAllocate, HostReallocate, HostFree, nullptr, nullptr};
+
+        return g_SwarmLibrary.forwardAllocationCallbacks ? &allocator : nullptr;
+    }
+}
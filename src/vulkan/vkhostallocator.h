@@ -0,0 +1,10 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+namespace swarm
+{
+    // Callbacks to pass to every Vulkan create and destroy call, VMA and vk-bootstrap.
+    // nullptr unless the user gave aligned callbacks to InitSwarm, the driver then uses its own allocator.
+    VkAllocationCallbacks *GetHostAllocator();
+}
@@ -7,6 +7,8 @@ namespace swarm
         assert(g_SwarmLibrary.isInitialized);
 
         vkb::InstanceBuilder builder{};
+        builder.require_api_version(1, 2, 0); // Timeline semaphores
+        builder.set_allocation_callbacks(GetHostAllocator());
 
         if (instanceCreateInfo.applicationName)
             builder.set_app_name(instanceCreateInfo.applicationName);
@@ -14,6 +16,9 @@ namespace swarm
         if (instanceCreateInfo.applicationVersion)
             builder.set_app_version(instanceCreateInfo.applicationVersion);
 
+        if (instanceCreateInfo.isHeadless)
+            builder.set_headless();
+
         if (instanceCreateInfo.isDebug)
         {
             builder.request_validation_layers();
@@ -33,7 +38,7 @@ namespace swarm
     void DestroyInstance(InstanceHandle &handle)
     {
         assert(g_SwarmLibrary.isInitialized);
-        assert(handle != nullptr);
+        assert(IsHandleAlive(handle));
 
         vkb::destroy_instance(handle->instance);
 
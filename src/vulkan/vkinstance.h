@@ -2,6 +2,8 @@
 #include <swarm_internal.h>
 
 #include <VkBootstrap.h>
+
+#include "vkhostallocator.h"
 namespace swarm
 {
     struct Instance_T
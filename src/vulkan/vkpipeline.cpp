@@ -5,19 +5,407 @@
 #include "utils.h"
 
 #include <cassert>
+#include <cstring>
+#include <string_view>
 #include <vector>
-#include <array>
+#include <memory>
 
 #include "vkdescriptorsetlayout.h"
 
 
 namespace swarm
 {
+    VkPrimitiveTopology ConvertPrimitiveTopology(PrimitiveTopology topology)
+    {
+        switch (topology)
+        {
+            case PrimitiveTopology::TRIANGLE_LIST:
+                return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            case PrimitiveTopology::TRIANGLE_STRIP:
+                return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+            case PrimitiveTopology::LINE_LIST:
+                return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+            case PrimitiveTopology::LINE_STRIP:
+                return VK_PRIMITIVE_TOPOLOGY_LINE_STRIP;
+            case PrimitiveTopology::POINT_LIST:
+                return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            default:
+                return VK_PRIMITIVE_TOPOLOGY_MAX_ENUM;
+        }
+    }
+
+    VkCullModeFlags ConvertCullMode(CullMode cullMode)
+    {
+        switch (cullMode)
+        {
+            case CullMode::NONE:
+                return VK_CULL_MODE_NONE;
+            case CullMode::FRONT:
+                return VK_CULL_MODE_FRONT_BIT;
+            case CullMode::BACK:
+                return VK_CULL_MODE_BACK_BIT;
+            case CullMode::FRONT_AND_BACK:
+                return VK_CULL_MODE_FRONT_AND_BACK;
+            default:
+                return VK_CULL_MODE_NONE;
+        }
+    }
+
+    VkFrontFace ConvertFrontFace(FrontFace frontFace)
+    {
+        switch (frontFace)
+        {
+            case FrontFace::COUNTER_CLOCKWISE:
+                return VK_FRONT_FACE_COUNTER_CLOCKWISE;
+            case FrontFace::CLOCKWISE:
+                return VK_FRONT_FACE_CLOCKWISE;
+            default:
+                return VK_FRONT_FACE_MAX_ENUM;
+        }
+    }
+
+    VkCompareOp ConvertCompareOp(CompareOp compareOp)
+    {
+        switch (compareOp)
+        {
+            case CompareOp::NEVER:
+                return VK_COMPARE_OP_NEVER;
+            case CompareOp::LESS:
+                return VK_COMPARE_OP_LESS;
+            case CompareOp::EQUAL:
+                return VK_COMPARE_OP_EQUAL;
+            case CompareOp::LESS_OR_EQUAL:
+                return VK_COMPARE_OP_LESS_OR_EQUAL;
+            case CompareOp::GREATER:
+                return VK_COMPARE_OP_GREATER;
+            case CompareOp::NOT_EQUAL:
+                return VK_COMPARE_OP_NOT_EQUAL;
+            case CompareOp::GREATER_OR_EQUAL:
+                return VK_COMPARE_OP_GREATER_OR_EQUAL;
+            case CompareOp::ALWAYS:
+                return VK_COMPARE_OP_ALWAYS;
+            default:
+                return VK_COMPARE_OP_MAX_ENUM;
+        }
+    }
+
+    static VkBlendFactor ConvertBlendFactor(BlendFactor factor)
+    {
+        switch (factor)
+        {
+            case BlendFactor::ZERO:
+                return VK_BLEND_FACTOR_ZERO;
+            case BlendFactor::ONE:
+                return VK_BLEND_FACTOR_ONE;
+            case BlendFactor::SRC_COLOR:
+                return VK_BLEND_FACTOR_SRC_COLOR;
+            case BlendFactor::ONE_MINUS_SRC_COLOR:
+                return VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+            case BlendFactor::DST_COLOR:
+                return VK_BLEND_FACTOR_DST_COLOR;
+            case BlendFactor::ONE_MINUS_DST_COLOR:
+                return VK_BLEND_FACTOR_ONE_MINUS_DST_COLOR;
+            case BlendFactor::SRC_ALPHA:
+                return VK_BLEND_FACTOR_SRC_ALPHA;
+            case BlendFactor::ONE_MINUS_SRC_ALPHA:
+                return VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+            case BlendFactor::DST_ALPHA:
+                return VK_BLEND_FACTOR_DST_ALPHA;
+            case BlendFactor::ONE_MINUS_DST_ALPHA:
+                return VK_BLEND_FACTOR_ONE_MINUS_DST_ALPHA;
+            default:
+                return VK_BLEND_FACTOR_MAX_ENUM;
+        }
+    }
+
+    static VkBlendOp ConvertBlendOp(BlendOp op)
+    {
+        switch (op)
+        {
+            case BlendOp::ADD:
+                return VK_BLEND_OP_ADD;
+            case BlendOp::SUBTRACT:
+                return VK_BLEND_OP_SUBTRACT;
+            case BlendOp::REVERSE_SUBTRACT:
+                return VK_BLEND_OP_REVERSE_SUBTRACT;
+            case BlendOp::MIN:
+                return VK_BLEND_OP_MIN;
+            case BlendOp::MAX:
+                return VK_BLEND_OP_MAX;
+            default:
+                return VK_BLEND_OP_MAX_ENUM;
+        }
+    }
+
+    // The first topology of each class, dynamic pipelines only bake the class in
+    static VkPrimitiveTopology GetTopologyClass(VkPrimitiveTopology topology)
+    {
+        switch (topology)
+        {
+            case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+                return VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+            case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+            case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+                return VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+            default:
+                return VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        }
+    }
+
+    static PipelineFixedState BuildFixedState(const Device_T *device, const PipelineCreateInfo &createInfo)
+    {
+        const BlendState &blend = createInfo.blend;
+
+        PipelineFixedState state{};
+        state.topology = ConvertPrimitiveTopology(createInfo.topology);
+        state.cullMode = ConvertCullMode(createInfo.cullMode);
+        state.frontFace = ConvertFrontFace(createInfo.frontFace);
+        state.depthTestEnable = createInfo.depthTestEnable;
+        state.depthWriteEnable = createInfo.depthWriteEnable;
+        state.depthCompareOp = ConvertCompareOp(createInfo.depthCompareOp);
+        state.blendEnable = blend.isEnabled;
+        state.srcColorFactor = ConvertBlendFactor(blend.srcColorFactor);
+        state.dstColorFactor = ConvertBlendFactor(blend.dstColorFactor);
+        state.colorOp = ConvertBlendOp(blend.colorOp);
+        state.srcAlphaFactor = ConvertBlendFactor(blend.srcAlphaFactor);
+        state.dstAlphaFactor = ConvertBlendFactor(blend.dstAlphaFactor);
+        state.alphaOp = ConvertBlendOp(blend.alphaOp);
+
+        if (createInfo.useDynamicState && device->capabilities.extendedDynamicState)
+        {
+            const PipelineFixedState defaults{};
+            state.isDynamic = VK_TRUE;
+            state.topology = GetTopologyClass(static_cast<VkPrimitiveTopology>(state.topology));
+            state.cullMode = defaults.cullMode;
+            state.frontFace = defaults.frontFace;
+            state.depthTestEnable = defaults.depthTestEnable;
+            state.depthWriteEnable = defaults.depthWriteEnable;
+            state.depthCompareOp = defaults.depthCompareOp;
+
+            if (device->capabilities.dynamicBlendEnable)
+            {
+                state.isBlendDynamic = VK_TRUE;
+                state.blendEnable = defaults.blendEnable;
+            }
+        }
+
+        return state;
+    }
+
+    // Vertex input descriptions are plain uint32_t fields without padding, hashed and compared as bytes
+    template<typename T>
+    static void HashBytes(size_t &seed, const std::vector<T> &values)
+    {
+        HashCombine(seed, values.size());
+        if (!values.empty())
+            HashCombine(seed, std::hash<std::string_view>{}(
+                            std::string_view(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T))));
+    }
+
+    template<typename T>
+    static bool EqualBytes(const std::vector<T> &a, const std::vector<T> &b)
+    {
+        return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    bool PipelineLayoutKey::operator==(const PipelineLayoutKey &other) const
+    {
+        return setLayout == other.setLayout &&
+               pushDescriptorLayout == other.pushDescriptorLayout &&
+               EqualBytes(pushConstantRanges, other.pushConstantRanges);
+    }
+
+    size_t PipelineLayoutKeyHash::operator()(const PipelineLayoutKey &key) const
+    {
+        size_t seed = 0;
+        HashHandleKey(seed, key.setLayout);
+        HashHandleKey(seed, key.pushDescriptorLayout);
+        HashBytes(seed, key.pushConstantRanges);
+        return seed;
+    }
+
+    static PipelineLayoutKey MakePipelineLayoutKey(const Device_T *device, DescriptorSetlayoutHandle setLayout,
+                                                   DescriptorSetlayoutHandle pushDescriptorLayout,
+                                                   const PushConstantRange *ranges, unsigned int rangeCount)
+    {
+        assert(ranges || rangeCount == 0);
+        assert(!setLayout || !setLayout->isPushDescriptor);
+        assert(!pushDescriptorLayout || pushDescriptorLayout->isPushDescriptor);
+
+        PipelineLayoutKey key{};
+        key.setLayout = MakeHandleKey(setLayout);
+        key.pushDescriptorLayout = MakeHandleKey(pushDescriptorLayout);
+
+        key.pushConstantRanges.resize(rangeCount);
+        for (unsigned int i = 0; i < rangeCount; i++)
+        {
+            assert(ranges[i].size > 0 && ranges[i].offset % 4 == 0 && ranges[i].size % 4 == 0);
+            assert(ranges[i].offset + ranges[i].size <= device->capabilities.maxPushConstantsSize);
+
+            key.pushConstantRanges[i].stageFlags = GetShaderStageFlags(ranges[i].stage);
+            key.pushConstantRanges[i].offset = ranges[i].offset;
+            key.pushConstantRanges[i].size = ranges[i].size;
+        }
+        return key;
+    }
+
+    bool PipelineStateKey::operator==(const PipelineStateKey &other) const
+    {
+        return bindPoint == other.bindPoint &&
+               vertexShader == other.vertexShader &&
+               fragmentShader == other.fragmentShader &&
+               computeShader == other.computeShader &&
+               renderpass == other.renderpass &&
+               layout == other.layout &&
+               fixedState == other.fixedState &&
+               EqualBytes(bindings, other.bindings) &&
+               EqualBytes(attributes, other.attributes);
+    }
+
+    size_t PipelineStateKeyHash::operator()(const PipelineStateKey &key) const
+    {
+        size_t seed = key.bindPoint;
+        HashHandleKey(seed, key.vertexShader);
+        HashHandleKey(seed, key.fragmentShader);
+        HashHandleKey(seed, key.computeShader);
+        HashHandleKey(seed, key.renderpass);
+        HashCombine(seed, PipelineLayoutKeyHash{}(key.layout));
+        HashCombine(seed, std::hash<std::string_view>{}(
+                        std::string_view(reinterpret_cast<const char *>(&key.fixedState), sizeof(PipelineFixedState))));
+        HashBytes(seed, key.bindings);
+        HashBytes(seed, key.attributes);
+        return seed;
+    }
+
+    // Takes a reference on the pipeline layout of `key`, creating it on first use
+    static VkPipelineLayout AcquirePipelineLayout(Device_T *device, const PipelineLayoutKey &key,
+                                                  DescriptorSetlayoutHandle setLayout,
+                                                  DescriptorSetlayoutHandle pushDescriptorLayout)
+    {
+        std::lock_guard lock(device->pipelineStateMutex);
+
+        PipelineLayoutEntry &entry = device->pipelineLayouts[key];
+        if (entry.pipelineLayout == VK_NULL_HANDLE)
+        {
+            VkDescriptorSetLayout setLayouts[2];
+            uint32_t setLayoutCount = 0;
+            if (setLayout)
+                setLayouts[setLayoutCount++] = setLayout->setLayout;
+            if (pushDescriptorLayout)
+                setLayouts[setLayoutCount++] = pushDescriptorLayout->setLayout;
+
+            VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+            pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipelineLayoutInfo.setLayoutCount = setLayoutCount;
+            pipelineLayoutInfo.pSetLayouts = setLayouts;
+            pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(key.pushConstantRanges.size());
+            pipelineLayoutInfo.pPushConstantRanges = key.pushConstantRanges.data();
+
+            if (vkCreatePipelineLayout(device->device, &pipelineLayoutInfo, GetHostAllocator(), &entry.pipelineLayout) != VK_SUCCESS)
+            {
+                device->pipelineLayouts.erase(key);
+                return VK_NULL_HANDLE;
+            }
+        }
+
+        entry.refCount++;
+        return entry.pipelineLayout;
+    }
+
+    // Expects pipelineStateMutex to be held
+    static void ReleasePipelineLayout(Device_T *device, const PipelineLayoutKey &key)
+    {
+        auto it = device->pipelineLayouts.find(key);
+        assert(it != device->pipelineLayouts.end());
+
+        if (--it->second.refCount > 0)
+            return;
+
+        VkPipelineLayout pipelineLayout = it->second.pipelineLayout;
+        device->pipelineLayouts.erase(it);
+
+        DestroyDeferred(device, [device, pipelineLayout]()
+        {
+            vkDestroyPipelineLayout(device->device, pipelineLayout, GetHostAllocator());
+        });
+    }
+
+    static PipelineHandle FindCachedPipeline(Device_T *device, const PipelineStateKey &key)
+    {
+        std::lock_guard lock(device->pipelineStateMutex);
+
+        auto it = device->pipelines.find(key);
+        if (it == device->pipelines.end())
+            return nullptr;
+
+        it->second->refCount++;
+        return it->second;
+    }
+
+    // Another thread may have built the same key meanwhile, its pipeline wins and ours is dropped
+    static PipelineHandle InsertCachedPipeline(Device_T *device, PipelineStateKey &&key, VkPipeline pipeline,
+                                               VkPipelineLayout pipelineLayout,
+                                               DescriptorSetlayoutHandle pushDescriptorLayout)
+    {
+        std::lock_guard lock(device->pipelineStateMutex);
+
+        auto it = device->pipelines.find(key);
+        if (it != device->pipelines.end())
+        {
+            vkDestroyPipeline(device->device, pipeline, GetHostAllocator());
+            ReleasePipelineLayout(device, key.layout);
+
+            it->second->refCount++;
+            return it->second;
+        }
+
+        PipelineHandle handle = SWARM_NEW<Pipeline_T>();
+        if (!handle)
+        {
+            vkDestroyPipeline(device->device, pipeline, GetHostAllocator());
+            ReleasePipelineLayout(device, key.layout);
+            return nullptr;
+        }
+
+        handle->pipeline = pipeline;
+        handle->pipelineLayout = pipelineLayout;
+        handle->bindPoint = key.bindPoint;
+        handle->pushDescriptorLayout = pushDescriptorLayout;
+        handle->pushDescriptorSet = key.layout.setLayout.handle ? 1 : 0;
+        handle->key = std::move(key);
+        handle->refCount = 1;
+
+        device->pipelines.emplace(handle->key, handle);
+        return handle;
+    }
+
     PipelineHandle CreatePipeline(DeviceHandle device, const PipelineCreateInfo &pipelineCreateInfo)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
 
+        PipelineStateKey key{};
+        key.bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        key.vertexShader = MakeHandleKey(pipelineCreateInfo.vertexShader);
+        key.fragmentShader = MakeHandleKey(pipelineCreateInfo.fragmentShader);
+        key.renderpass = MakeHandleKey(pipelineCreateInfo.renderpass);
+        key.layout = MakePipelineLayoutKey(device, pipelineCreateInfo.descriptoSetLayout,
+                                           pipelineCreateInfo.pushDescriptorLayout, pipelineCreateInfo.pushConstantRanges,
+                                           pipelineCreateInfo.pushConstantRangeCount);
+        key.fixedState = BuildFixedState(device, pipelineCreateInfo);
+        key.bindings = BuildVertexInputBindings(pipelineCreateInfo.vertexSpec);
+        key.attributes = BuildVertexInputAttributes(pipelineCreateInfo.vertexSpec);
+
+        if (PipelineHandle cached = FindCachedPipeline(device, key))
+            return cached;
+
+        // Packed formats such as SNORM_A2B10G10R10 are optional for vertex buffers
+        for (const VkVertexInputAttributeDescription &attribute : key.attributes)
+        {
+            if (!(GetFormatProperties(device->capabilityCache, attribute.format).bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT))
+                return nullptr;
+        }
+
         VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
         vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
         vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -35,17 +423,16 @@ namespace swarm
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 
-        auto bindingDescriptions = BuildVertexInputBindings(pipelineCreateInfo.vertexSpec);
-        auto attributeDescriptions = BuildVertexInputAttributes(pipelineCreateInfo.vertexSpec);
-
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(key.bindings.size());
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(key.attributes.size());
+        vertexInputInfo.pVertexBindingDescriptions = key.bindings.data();
+        vertexInputInfo.pVertexAttributeDescriptions = key.attributes.data();
 
         VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
         inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        const PipelineFixedState &fixedState = key.fixedState;
+
+        inputAssembly.topology = static_cast<VkPrimitiveTopology>(fixedState.topology);
         inputAssembly.primitiveRestartEnable = VK_FALSE;
 
         VkPipelineViewportStateCreateInfo viewportState{};
@@ -59,8 +446,8 @@ namespace swarm
         rasterizer.rasterizerDiscardEnable = VK_FALSE;
         rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
         rasterizer.lineWidth = 1.0f;
-        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterizer.cullMode = fixedState.cullMode;
+        rasterizer.frontFace = static_cast<VkFrontFace>(fixedState.frontFace);
         rasterizer.depthBiasEnable = VK_FALSE;
 
         VkPipelineMultisampleStateCreateInfo multisampling{};
@@ -70,16 +457,22 @@ namespace swarm
 
         VkPipelineDepthStencilStateCreateInfo depthStencil{};
         depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-        depthStencil.depthTestEnable = VK_TRUE;
-        depthStencil.depthWriteEnable = VK_TRUE;
-        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthStencil.depthTestEnable = fixedState.depthTestEnable;
+        depthStencil.depthWriteEnable = fixedState.depthWriteEnable;
+        depthStencil.depthCompareOp = static_cast<VkCompareOp>(fixedState.depthCompareOp);
         depthStencil.depthBoundsTestEnable = VK_FALSE;
         depthStencil.stencilTestEnable = VK_FALSE;
 
         VkPipelineColorBlendAttachmentState colorBlendAttachment{};
         colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
                                               VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-        colorBlendAttachment.blendEnable = VK_FALSE;
+        colorBlendAttachment.blendEnable = fixedState.blendEnable;
+        colorBlendAttachment.srcColorBlendFactor = static_cast<VkBlendFactor>(fixedState.srcColorFactor);
+        colorBlendAttachment.dstColorBlendFactor = static_cast<VkBlendFactor>(fixedState.dstColorFactor);
+        colorBlendAttachment.colorBlendOp = static_cast<VkBlendOp>(fixedState.colorOp);
+        colorBlendAttachment.srcAlphaBlendFactor = static_cast<VkBlendFactor>(fixedState.srcAlphaFactor);
+        colorBlendAttachment.dstAlphaBlendFactor = static_cast<VkBlendFactor>(fixedState.dstAlphaFactor);
+        colorBlendAttachment.alphaBlendOp = static_cast<VkBlendOp>(fixedState.alphaOp);
 
         VkPipelineColorBlendStateCreateInfo colorBlending{};
         colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
@@ -96,48 +489,28 @@ namespace swarm
             VK_DYNAMIC_STATE_VIEWPORT,
             VK_DYNAMIC_STATE_SCISSOR
         };
+        if (fixedState.isDynamic)
+        {
+            dynamicStates.insert(dynamicStates.end(), {
+                VK_DYNAMIC_STATE_CULL_MODE_EXT,
+                VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+                VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+                VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+                VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+                VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT
+            });
+        }
+        if (fixedState.isBlendDynamic)
+            dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT);
         VkPipelineDynamicStateCreateInfo dynamicState{};
         dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
         dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
         dynamicState.pDynamicStates = dynamicStates.data();
 
 
-        //DescriptorLayout
-        VkDescriptorSetLayoutBinding uboLayoutBinding{};
-        uboLayoutBinding.binding = 0;
-        uboLayoutBinding.descriptorCount = 1;
-        uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        uboLayoutBinding.pImmutableSamplers = nullptr;
-        uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-        VkDescriptorSetLayoutBinding samplerLayoutBinding{};
-        samplerLayoutBinding.binding = 1;
-        samplerLayoutBinding.descriptorCount = 1;
-        samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        samplerLayoutBinding.pImmutableSamplers = nullptr;
-        samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-        std::array<VkDescriptorSetLayoutBinding, 2> bindings = {uboLayoutBinding, samplerLayoutBinding};
-        VkDescriptorSetLayoutCreateInfo layoutInfo{};
-        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-        layoutInfo.pBindings = bindings.data();
-
-
-        VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
-        if (vkCreateDescriptorSetLayout(device->device, &layoutInfo, nullptr, &setLayout) != VK_SUCCESS)
-        {
-            return nullptr;
-        }
-
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = 1;
-        pipelineLayoutInfo.pSetLayouts = &pipelineCreateInfo.descriptoSetLayout->setLayout;
-
-
-        VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
-        if (vkCreatePipelineLayout(device->device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+        VkPipelineLayout pipelineLayout = AcquirePipelineLayout(device, key.layout, pipelineCreateInfo.descriptoSetLayout,
+                                                               pipelineCreateInfo.pushDescriptorLayout);
+        if (pipelineLayout == VK_NULL_HANDLE)
         {
             return nullptr;
         }
@@ -159,29 +532,139 @@ namespace swarm
         pipelineInfo.subpass = 0;
         pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
+        PipelineCreationFeedback feedback{};
+        pipelineInfo.pNext = PreparePipelineCreationFeedback(device, feedback, pipelineInfo.pNext);
+
         VkPipeline pipeline{VK_NULL_HANDLE};
-        if (vkCreateGraphicsPipelines(device->device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+        if (vkCreateGraphicsPipelines(device->device, device->pipelineCache.cache, 1, &pipelineInfo, GetHostAllocator(), &pipeline) != VK_SUCCESS)
         {
+            std::lock_guard lock(device->pipelineStateMutex);
+            ReleasePipelineLayout(device, key.layout);
             return nullptr;
         }
+        RecordPipelineCreation(device, feedback);
 
-        PipelineHandle handle = SWARM_NEW<Pipeline_T>();
-        handle->pipeline = pipeline;
-        handle->pipelineLayout = pipelineLayout;
-        handle->descriptorSetLayout = setLayout;
-        return handle;
+        return InsertCachedPipeline(device, std::move(key), pipeline, pipelineLayout,
+                                    pipelineCreateInfo.pushDescriptorLayout);
+    }
+
+    std::future<PipelineHandle> CreatePipelineAsync(DeviceHandle device, const PipelineCreateInfo &pipelineCreateInfo)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        {
+            std::lock_guard lock(device->pipelineWorkersMutex);
+            if (!device->pipelineWorkers.IsRunning())
+                device->pipelineWorkers.Start(device->pipelineWorkerCount);
+        }
+
+        // std::function needs a copyable job, the promise is shared with it
+        auto promise = std::make_shared<std::promise<PipelineHandle>>();
+        std::future<PipelineHandle> future = promise->get_future();
+
+        device->pipelineWorkers.Submit([device, pipelineCreateInfo, promise]()
+        {
+            promise->set_value(CreatePipeline(device, pipelineCreateInfo));
+        });
+
+        return future;
+    }
+
+    bool CreatePipelines(DeviceHandle device, const PipelineCreateInfo *createInfos, size_t count, PipelineHandle *pipelines)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(createInfos || count == 0);
+        assert(pipelines || count == 0);
+
+        std::vector<std::future<PipelineHandle>> futures;
+        futures.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            futures.push_back(CreatePipelineAsync(device, createInfos[i]));
+
+        bool isSuccess = true;
+        for (size_t i = 0; i < count; i++)
+        {
+            pipelines[i] = futures[i].get();
+            isSuccess &= pipelines[i] != nullptr;
+        }
+
+        return isSuccess;
+    }
+
+    PipelineHandle CreateComputePipeline(DeviceHandle device, const ComputePipelineCreateInfo &pipelineCreateInfo)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(pipelineCreateInfo.computeShader);
+        assert(pipelineCreateInfo.computeShader->stage == ShaderStage::COMPUTE);
+
+        PipelineStateKey key{};
+        key.bindPoint = VK_PIPELINE_BIND_POINT_COMPUTE;
+        key.computeShader = MakeHandleKey(pipelineCreateInfo.computeShader);
+        key.layout = MakePipelineLayoutKey(device, pipelineCreateInfo.descriptorSetLayout,
+                                           pipelineCreateInfo.pushDescriptorLayout, pipelineCreateInfo.pushConstantRanges,
+                                           pipelineCreateInfo.pushConstantRangeCount);
+
+        if (PipelineHandle cached = FindCachedPipeline(device, key))
+            return cached;
+
+        VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+        computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        computeShaderStageInfo.module = pipelineCreateInfo.computeShader->module;
+        computeShaderStageInfo.pName = "main";
+
+        VkPipelineLayout pipelineLayout = AcquirePipelineLayout(device, key.layout, pipelineCreateInfo.descriptorSetLayout,
+                                                               pipelineCreateInfo.pushDescriptorLayout);
+        if (pipelineLayout == VK_NULL_HANDLE)
+        {
+            return nullptr;
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = computeShaderStageInfo;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        PipelineCreationFeedback feedback{};
+        pipelineInfo.pNext = PreparePipelineCreationFeedback(device, feedback, pipelineInfo.pNext);
+
+        VkPipeline pipeline{VK_NULL_HANDLE};
+        if (vkCreateComputePipelines(device->device, device->pipelineCache.cache, 1, &pipelineInfo, GetHostAllocator(), &pipeline) != VK_SUCCESS)
+        {
+            std::lock_guard lock(device->pipelineStateMutex);
+            ReleasePipelineLayout(device, key.layout);
+            return nullptr;
+        }
+        RecordPipelineCreation(device, feedback);
+
+        return InsertCachedPipeline(device, std::move(key), pipeline, pipelineLayout,
+                                    pipelineCreateInfo.pushDescriptorLayout);
     }
 
     void DestroyPipeline(DeviceHandle device, PipelineHandle &handle)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
+
+        std::lock_guard lock(device->pipelineStateMutex);
+        if (--handle->refCount > 0)
+            return;
 
-        vkDestroyDescriptorSetLayout(device->device, handle->descriptorSetLayout, nullptr);
-        vkDestroyPipelineLayout(device->device, handle->pipelineLayout, nullptr);
-        vkDestroyPipeline(device->device, handle->pipeline, nullptr);
+        PipelineHandle pipeline = handle;
+        RetireHandle(pipeline);
+        device->pipelines.erase(pipeline->key);
+        ReleasePipelineLayout(device, pipeline->key.layout);
+
+        DestroyDeferred(device, [device, pipeline]()
+        {
+            vkDestroyPipeline(device->device, pipeline->pipeline, GetHostAllocator());
 
-        SWARM_DELETE(handle);
+            SWARM_DELETE(pipeline);
+        });
     }
 }
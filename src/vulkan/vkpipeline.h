@@ -1,12 +1,121 @@
 #pragma once
 #include <swarm_internal.h>
 #include <vulkan/vulkan.h>
+
+#include <functional>
+#include <vector>
 namespace swarm
 {
+    // Address plus slot generation, a recycled address never matches the destroyed object
+    struct HandleKey
+    {
+        const void *handle{nullptr};
+        uint32_t generation{0};
+
+        bool operator==(const HandleKey &other) const = default;
+    };
+
+    template<typename T>
+    HandleKey MakeHandleKey(const T *handle)
+    {
+        return handle ? HandleKey{handle, GetHandleGeneration(handle)} : HandleKey{};
+    }
+
+    inline void HashCombine(size_t &seed, size_t value)
+    {
+        seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+
+    inline void HashHandleKey(size_t &seed, const HandleKey &key)
+    {
+        HashCombine(seed, std::hash<const void *>{}(key.handle));
+        HashCombine(seed, key.generation);
+    }
+
+    VkPrimitiveTopology ConvertPrimitiveTopology(PrimitiveTopology topology);
+    VkCullModeFlags ConvertCullMode(CullMode cullMode);
+    VkFrontFace ConvertFrontFace(FrontFace frontFace);
+    VkCompareOp ConvertCompareOp(CompareOp compareOp);
+
+    // Fixed function state in Vulkan terms, all 32 bit fields so keys hash and compare as bytes.
+    // Fields left to dynamic state hold their defaults so those pipelines share a key.
+    struct PipelineFixedState
+    {
+        uint32_t topology{VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST};
+        uint32_t cullMode{VK_CULL_MODE_BACK_BIT};
+        uint32_t frontFace{VK_FRONT_FACE_COUNTER_CLOCKWISE};
+        uint32_t depthTestEnable{VK_TRUE};
+        uint32_t depthWriteEnable{VK_TRUE};
+        uint32_t depthCompareOp{VK_COMPARE_OP_LESS};
+        uint32_t blendEnable{VK_FALSE};
+        uint32_t srcColorFactor{VK_BLEND_FACTOR_SRC_ALPHA};
+        uint32_t dstColorFactor{VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA};
+        uint32_t colorOp{VK_BLEND_OP_ADD};
+        uint32_t srcAlphaFactor{VK_BLEND_FACTOR_ONE};
+        uint32_t dstAlphaFactor{VK_BLEND_FACTOR_ZERO};
+        uint32_t alphaOp{VK_BLEND_OP_ADD};
+        uint32_t isDynamic{VK_FALSE};
+        uint32_t isBlendDynamic{VK_FALSE};
+
+        bool operator==(const PipelineFixedState &other) const = default;
+    };
+
+    // Push descriptors take the set right after `setLayout`, or set 0 without one
+    struct PipelineLayoutKey
+    {
+        HandleKey setLayout;
+        HandleKey pushDescriptorLayout;
+        std::vector<VkPushConstantRange> pushConstantRanges;
+
+        bool operator==(const PipelineLayoutKey &other) const;
+    };
+
+    struct PipelineLayoutKeyHash
+    {
+        size_t operator()(const PipelineLayoutKey &key) const;
+    };
+
+    // Everything a pipeline is built from, equal keys always give interchangeable pipelines
+    struct PipelineStateKey
+    {
+        VkPipelineBindPoint bindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS};
+        HandleKey vertexShader;
+        HandleKey fragmentShader;
+        HandleKey computeShader;
+        HandleKey renderpass;
+        PipelineLayoutKey layout;
+        PipelineFixedState fixedState;
+
+        std::vector<VkVertexInputBindingDescription> bindings;
+        std::vector<VkVertexInputAttributeDescription> attributes;
+
+        bool operator==(const PipelineStateKey &other) const;
+    };
+
+    struct PipelineStateKeyHash
+    {
+        size_t operator()(const PipelineStateKey &key) const;
+    };
+
+    // Shared by every pipeline created with the same descriptor set layout
+    struct PipelineLayoutEntry
+    {
+        VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
+        uint32_t refCount{0};
+    };
+
+    // CreatePipeline calls with an equal key return the same object, it is destroyed with its last reference
     struct Pipeline_T
     {
         VkPipeline pipeline{VK_NULL_HANDLE};
         VkPipelineLayout pipelineLayout{VK_NULL_HANDLE};
-        VkDescriptorSetLayout descriptorSetLayout{VK_NULL_HANDLE};
+        VkPipelineBindPoint bindPoint{VK_PIPELINE_BIND_POINT_GRAPHICS};
+
+        // Resolves the bindings of CmdPushDescriptorSet, nullptr without push descriptors
+        DescriptorSetlayoutHandle pushDescriptorLayout{nullptr};
+        uint32_t pushDescriptorSet{0};
+
+        PipelineStateKey key;
+        uint32_t refCount{0};
     };
 }
@@ -0,0 +1,131 @@
+#include "vkpipelinecache.h"
+#include "vkdevice.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace swarm
+{
+    // Layout of VkPipelineCacheHeaderVersionOne, read field by field since the blob has no alignment guarantee
+    static constexpr size_t PipelineCacheHeaderSize = 16 + VK_UUID_SIZE;
+
+    static bool IsPipelineCacheCompatible(const Device_T *device, const void *data, size_t size)
+    {
+        if (!data || size < PipelineCacheHeaderSize)
+            return false;
+
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        uint32_t headerSize, headerVersion, vendorID, deviceID;
+        memcpy(&headerSize, bytes, sizeof(uint32_t));
+        memcpy(&headerVersion, bytes + 4, sizeof(uint32_t));
+        memcpy(&vendorID, bytes + 8, sizeof(uint32_t));
+        memcpy(&deviceID, bytes + 12, sizeof(uint32_t));
+
+        const VkPhysicalDeviceProperties &properties = device->capabilityCache.properties;
+        return headerSize >= PipelineCacheHeaderSize && headerSize <= size &&
+               headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+               vendorID == properties.vendorID &&
+               deviceID == properties.deviceID &&
+               memcmp(bytes + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    bool CreatePipelineCache(Device_T *device, const void *data, size_t size, PipelineCache &cache)
+    {
+        // A blob from another driver or GPU would be rejected or, with buggy drivers, misread
+        cache.isSeeded = IsPipelineCacheCompatible(device, data, size);
+
+        VkPipelineCacheCreateInfo cacheInfo{};
+        cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        if (cache.isSeeded)
+        {
+            cacheInfo.initialDataSize = size;
+            cacheInfo.pInitialData = data;
+        }
+
+        VkResult result = vkCreatePipelineCache(device->device, &cacheInfo, GetHostAllocator(), &cache.cache);
+        if (result != VK_SUCCESS && cache.isSeeded)
+        {
+            cache.isSeeded = false;
+            cacheInfo.initialDataSize = 0;
+            cacheInfo.pInitialData = nullptr;
+            result = vkCreatePipelineCache(device->device, &cacheInfo, GetHostAllocator(), &cache.cache);
+        }
+
+        if (result != VK_SUCCESS)
+        {
+            cache.cache = VK_NULL_HANDLE;
+            return false;
+        }
+
+        return true;
+    }
+
+    void DestroyPipelineCache(Device_T *device, PipelineCache &cache)
+    {
+        vkDestroyPipelineCache(device->device, cache.cache, GetHostAllocator());
+        cache.cache = VK_NULL_HANDLE;
+    }
+
+    const void *PreparePipelineCreationFeedback(const Device_T *device, PipelineCreationFeedback &feedback, const void *next)
+    {
+        if (!device->pipelineCache.hasCreationFeedback)
+            return next;
+
+        feedback.createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+        feedback.createInfo.pNext = next;
+        feedback.createInfo.pPipelineCreationFeedback = &feedback.pipelineFeedback;
+        return &feedback.createInfo;
+    }
+
+    void RecordPipelineCreation(Device_T *device, const PipelineCreationFeedback &feedback)
+    {
+        PipelineCache &cache = device->pipelineCache;
+
+        const VkPipelineCreationFeedbackEXT &pipelineFeedback = feedback.pipelineFeedback;
+        if (!(pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+        {
+            cache.unknown++;
+            return;
+        }
+
+        if (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+            cache.hits++;
+        else
+            cache.misses++;
+
+        cache.creationTime += pipelineFeedback.duration;
+    }
+
+    size_t GetPipelineCacheData(DeviceHandle device, void *data, size_t size)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        if (device->pipelineCache.cache == VK_NULL_HANDLE)
+            return 0;
+
+        size_t dataSize = data ? size : 0;
+        VkResult result = vkGetPipelineCacheData(device->device, device->pipelineCache.cache, &dataSize, data);
+        if (result != VK_SUCCESS)
+            return 0;
+
+        return dataSize;
+    }
+
+    PipelineCacheStats GetPipelineCacheStats(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        const PipelineCache &cache = device->pipelineCache;
+
+        PipelineCacheStats stats{};
+        stats.isSeeded = cache.isSeeded;
+        stats.hasCreationFeedback = cache.hasCreationFeedback;
+        stats.hits = cache.hits;
+        stats.misses = cache.misses;
+        stats.unknown = cache.unknown;
+        stats.creationTime = cache.creationTime;
+        return stats;
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+namespace swarm
+{
+    struct Device_T;
+
+    // Device wide VkPipelineCache, every pipeline of the device is created through it
+    struct PipelineCache
+    {
+        VkPipelineCache cache{VK_NULL_HANDLE};
+        bool hasCreationFeedback{false}; //VK_EXT_pipeline_creation_feedback, hits and misses are unknown without it
+        bool isSeeded{false};
+
+        std::atomic<uint32_t> hits{0};
+        std::atomic<uint32_t> misses{0};
+        std::atomic<uint32_t> unknown{0};
+        std::atomic<uint64_t> creationTime{0};
+    };
+
+    // Seeds the cache with `data` when its header matches the device, starts empty otherwise
+    bool CreatePipelineCache(Device_T *device, const void *data, size_t size, PipelineCache &cache);
+    void DestroyPipelineCache(Device_T *device, PipelineCache &cache);
+
+    // Chained in the pNext of a pipeline create info, its result is counted by RecordPipelineCreation
+    struct PipelineCreationFeedback
+    {
+        VkPipelineCreationFeedbackEXT pipelineFeedback{};
+        VkPipelineCreationFeedbackCreateInfoEXT createInfo{};
+    };
+
+    // Returns the pointer to chain, nullptr when the device can't report feedback
+    const void *PreparePipelineCreationFeedback(const Device_T *device, PipelineCreationFeedback &feedback, const void *next);
+    void RecordPipelineCreation(Device_T *device, const PipelineCreationFeedback &feedback);
+}
@@ -7,20 +7,43 @@
 #include "vkcommandbuffer.h"
 #include "vkrenderpass.h"
 #include "vkframebuffer.h"
+#include "vktransientallocator.h"
+#include "vkpipeline.h"
+#include "vkbuffer.h"
+#include "vkdescriptorpool.h"
 
 #include <vulkan/vulkan.h>
 
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
 
 namespace swarm
 {
     unsigned int CmdBeginFrame(CmdBeginFrameInfo &info)
     {
+        assert(IsHandleAlive(info.commandBuffer));
+        assert(IsHandleAlive(info.inFlightFence));
+
         vkWaitForFences(info.device->device, 1, &info.inFlightFence->fence, VK_TRUE, UINT64_MAX);
+
+        // The GPU is done with the frame that last used the next region
+        if (info.transientAllocator)
+            TransientAllocatorNextFrame(info.transientAllocator);
+        if (info.descriptorPool)
+            ResetDescriptorPool(info.device, info.descriptorPool);
+
+        CollectDeferredReleases(info.device, false);
+
         unsigned int imageIndex = 0;
-        vkAcquireNextImageKHR(info.device->device, info.swapchain->swapchain, UINT64_MAX, info.imageAvailableSemaphore->semaphore, nullptr, &imageIndex);
+        if (info.swapchain)
+            vkAcquireNextImageKHR(info.device->device, info.swapchain->swapchain, UINT64_MAX, info.imageAvailableSemaphore->semaphore, nullptr, &imageIndex);
 
         vkResetFences(info.device->device, 1, &info.inFlightFence->fence);
         vkResetCommandBuffer(info.commandBuffer->commandBuffer, 0);
+        ResetCommandBufferState(info.commandBuffer);
 
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -35,7 +58,7 @@ namespace swarm
         renderPassInfo.renderPass = info.renderpass->renderPass;
         renderPassInfo.framebuffer = info.framebuffer->framebuffers[imageIndex];
         renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = info.swapchain->swapchain.extent;
+        renderPassInfo.renderArea.extent = info.framebuffer->extent;
 
         renderPassInfo.clearValueCount = info.renderpass->clearValues.size();
         renderPassInfo.pClearValues = info.renderpass->clearValues.data();
@@ -46,6 +69,8 @@ namespace swarm
 
     void CmdEndFrame(CmdEndFrameInfo& info)
     {
+        assert(IsHandleAlive(info.commandBuffer));
+
         vkCmdEndRenderPass(info.commandBuffer->commandBuffer);
 
         if (vkEndCommandBuffer(info.commandBuffer->commandBuffer) != VK_SUCCESS)
@@ -54,34 +79,143 @@ namespace swarm
         }
     }
 
+    void BeginCommandBuffer(CommandBufferHandle commandBuffer)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(IsHandleAlive(commandBuffer));
+
+        vkResetCommandBuffer(commandBuffer->commandBuffer, 0);
+        ResetCommandBufferState(commandBuffer);
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(commandBuffer->commandBuffer, &beginInfo) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to begin recording command buffer!");
+        }
+    }
+
+    void EndCommandBuffer(CommandBufferHandle commandBuffer)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(IsHandleAlive(commandBuffer));
+
+        if (vkEndCommandBuffer(commandBuffer->commandBuffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to record command buffer!");
+        }
+    }
+
+    // Semaphores of one submission, binary ones use a value of 0 in the timeline arrays
+    struct SubmitSemaphores
+    {
+        std::vector<VkSemaphore> waits;
+        std::vector<uint64_t> waitValues;
+        std::vector<VkPipelineStageFlags> waitStages;
+
+        std::vector<VkSemaphore> signals;
+        std::vector<uint64_t> signalValues;
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+
+        void AddWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stage)
+        {
+            waits.push_back(semaphore);
+            waitValues.push_back(value);
+            waitStages.push_back(stage);
+        }
+
+        void AddSignal(VkSemaphore semaphore, uint64_t value)
+        {
+            signals.push_back(semaphore);
+            signalValues.push_back(value);
+        }
+
+        void AddTimelines(const TimelinePoint *timelineWaits, unsigned int waitCount,
+                          const TimelinePoint *timelineSignals, unsigned int signalCount)
+        {
+            for (unsigned int i = 0; i < waitCount; i++)
+            {
+                assert(IsHandleAlive(timelineWaits[i].timeline));
+                AddWait(timelineWaits[i].timeline->semaphore, timelineWaits[i].value, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+            }
+
+            for (unsigned int i = 0; i < signalCount; i++)
+            {
+                assert(IsHandleAlive(timelineSignals[i].timeline));
+                AddSignal(timelineSignals[i].timeline->semaphore, timelineSignals[i].value);
+            }
+        }
+
+        // Every submission advances the timeline of its queue, and when uploads run on another queue waits for the
+        // ones flushed so far so that what they wrote is visible to it
+        void AddDeviceSync(Device_T *device, VkQueue queue, VkSemaphore queueTimeline, uint64_t &queueValue)
+        {
+            const UploadContext &uploads = device->uploadContext;
+            if (device->uploadQueue != queue && uploads.submittedSerial > 0)
+                AddWait(uploads.timeline, uploads.submittedSerial, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+            std::lock_guard lock(device->releaseMutex);
+            AddSignal(queueTimeline, ++queueValue);
+        }
+
+        void Fill(VkSubmitInfo &submitInfo)
+        {
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+            timelineInfo.pWaitSemaphoreValues = waitValues.data();
+            timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+            timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waits.size());
+            submitInfo.pWaitSemaphores = waits.data();
+            submitInfo.pWaitDstStageMask = waitStages.data();
+            submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signals.size());
+            submitInfo.pSignalSemaphores = signals.data();
+        }
+    };
+
     void CmdSubmitFrame(CmdSubmitInfo& info)
     {
+        assert(IsHandleAlive(info.commandBuffer));
+        assert(IsHandleAlive(info.inFlightFence));
+
+        VkSemaphore renderFinishedSemaphore{VK_NULL_HANDLE};
+
+        SubmitSemaphores semaphores;
+        if (info.swapchain)
+        {
+            renderFinishedSemaphore = info.renderFinishedSemaphore[info.imageIndex]->semaphore;
+            semaphores.AddWait(info.imageAvailableSemaphore->semaphore, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+            semaphores.AddSignal(renderFinishedSemaphore, 0);
+        }
+        semaphores.AddTimelines(info.timelineWaits, info.timelineWaitCount, info.timelineSignals, info.timelineSignalCount);
+        semaphores.AddDeviceSync(info.device, info.device->graphicsQueue, info.device->submissionTimeline,
+                                 info.device->submissionValue);
+
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-        VkSemaphore waitSemaphores[] = {info.imageAvailableSemaphore->semaphore};
-        VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = waitSemaphores;
-        submitInfo.pWaitDstStageMask = waitStages;
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &info.commandBuffer->commandBuffer;
+        semaphores.Fill(submitInfo);
 
-        VkSemaphore signalSemaphores[] = {info.renderFinishedSemaphore[info.imageIndex]->semaphore};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signalSemaphores;
-
-        if (vkQueueSubmit(info.device->device.get_queue(vkb::QueueType::graphics).value(), 1, &submitInfo,
+        if (vkQueueSubmit(info.device->graphicsQueue, 1, &submitInfo,
                           info.inFlightFence->fence) != VK_SUCCESS)
         {
             throw std::runtime_error("failed to submit draw command buffer!");
         }
 
+        if (!info.swapchain)
+            return;
+
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
         presentInfo.waitSemaphoreCount = 1;
-        presentInfo.pWaitSemaphores = signalSemaphores;
+        presentInfo.pWaitSemaphores = &renderFinishedSemaphore;
 
         VkSwapchainKHR swapChains[] = {info.swapchain->swapchain};
         presentInfo.swapchainCount = 1;
@@ -91,4 +225,419 @@ namespace swarm
 
         vkQueuePresentKHR(info.device->device.get_queue(vkb::QueueType::present).value(), &presentInfo);
     }
+
+    void QueueSubmit(DeviceHandle device, const QueueSubmitInfo& info)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        std::vector<VkCommandBuffer> commandBuffers(info.commandBufferCount);
+        for (unsigned int i = 0; i < info.commandBufferCount; i++)
+        {
+            assert(IsHandleAlive(info.commandBuffers[i]));
+            commandBuffers[i] = info.commandBuffers[i]->commandBuffer;
+        }
+
+        // Compute falls back to the graphics queue when the device has no async compute queue
+        const bool isAsyncCompute = info.queue == QueueType::COMPUTE && device->computeQueue != VK_NULL_HANDLE;
+        VkQueue queue = isAsyncCompute ? device->computeQueue : device->graphicsQueue;
+
+        SubmitSemaphores semaphores;
+        semaphores.AddTimelines(info.waits, info.waitCount, info.signals, info.signalCount);
+        if (isAsyncCompute)
+            semaphores.AddDeviceSync(device, queue, device->computeTimeline, device->computeSubmissionValue);
+        else
+            semaphores.AddDeviceSync(device, queue, device->submissionTimeline, device->submissionValue);
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
+        submitInfo.pCommandBuffers = commandBuffers.data();
+        semaphores.Fill(submitInfo);
+
+        if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit command buffers!");
+        }
+    }
+
+    static CommandBufferState::BindPointState &GetBindPointState(CommandBuffer_T *commandBuffer,
+                                                                 VkPipelineBindPoint bindPoint)
+    {
+        assert(bindPoint < commandBuffer->state.bindPoints.size());
+        return commandBuffer->state.bindPoints[bindPoint];
+    }
+
+    void CmdBindPipeline(CommandBufferHandle commandBuffer, PipelineHandle pipeline)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(pipeline));
+
+        CommandBufferState::BindPointState &bound = GetBindPointState(commandBuffer, pipeline->bindPoint);
+        if (bound.pipeline == pipeline->pipeline)
+        {
+            commandBuffer->stats.filteredCalls++;
+            return;
+        }
+
+        bound.pipeline = pipeline->pipeline;
+        vkCmdBindPipeline(commandBuffer->commandBuffer, pipeline->bindPoint, pipeline->pipeline);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetViewport(CommandBufferHandle commandBuffer, const Viewport &viewport)
+    {
+        assert(IsHandleAlive(commandBuffer));
+
+        const VkViewport vkViewport{viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth};
+
+        CommandBufferState &state = commandBuffer->state;
+        if (state.hasViewport && memcmp(&state.viewport, &vkViewport, sizeof(VkViewport)) == 0)
+        {
+            commandBuffer->stats.filteredCalls++;
+            return;
+        }
+
+        state.hasViewport = true;
+        state.viewport = vkViewport;
+        vkCmdSetViewport(commandBuffer->commandBuffer, 0, 1, &vkViewport);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetScissor(CommandBufferHandle commandBuffer, int x, int y, unsigned int width, unsigned int height)
+    {
+        assert(IsHandleAlive(commandBuffer));
+
+        const VkRect2D scissor{{x, y}, {width, height}};
+
+        CommandBufferState &state = commandBuffer->state;
+        if (state.hasScissor && memcmp(&state.scissor, &scissor, sizeof(VkRect2D)) == 0)
+        {
+            commandBuffer->stats.filteredCalls++;
+            return;
+        }
+
+        state.hasScissor = true;
+        state.scissor = scissor;
+        vkCmdSetScissor(commandBuffer->commandBuffer, 0, 1, &scissor);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdBindVertexBuffers(CommandBufferHandle commandBuffer, unsigned int firstBinding, const BufferHandle *buffers,
+                              const unsigned int *offsets, unsigned int count)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(buffers && count > 0);
+        assert(firstBinding + count <= CommandBufferState::MAX_VERTEX_BINDINGS);
+
+        CommandBufferState &state = commandBuffer->state;
+        VkBuffer vkBuffers[CommandBufferState::MAX_VERTEX_BINDINGS];
+        VkDeviceSize vkOffsets[CommandBufferState::MAX_VERTEX_BINDINGS];
+
+        // Narrowed down to the range of bindings that actually changed
+        unsigned int firstChanged = count;
+        unsigned int lastChanged = 0;
+        for (unsigned int i = 0; i < count; i++)
+        {
+            assert(IsHandleAlive(buffers[i]));
+            vkBuffers[i] = buffers[i]->buffer;
+            vkOffsets[i] = buffers[i]->offset + (offsets ? offsets[i] : 0);
+
+            const unsigned int binding = firstBinding + i;
+            if (state.vertexBuffers[binding] == vkBuffers[i] && state.vertexOffsets[binding] == vkOffsets[i])
+                continue;
+
+            state.vertexBuffers[binding] = vkBuffers[i];
+            state.vertexOffsets[binding] = vkOffsets[i];
+            firstChanged = std::min(firstChanged, i);
+            lastChanged = i;
+        }
+
+        if (firstChanged == count)
+        {
+            commandBuffer->stats.filteredCalls++;
+            return;
+        }
+
+        vkCmdBindVertexBuffers(commandBuffer->commandBuffer, firstBinding + firstChanged, lastChanged - firstChanged + 1,
+                               vkBuffers + firstChanged, vkOffsets + firstChanged);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdBindIndexBuffer(CommandBufferHandle commandBuffer, BufferHandle buffer, IndexType indexType,
+                            unsigned int offset)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(buffer));
+
+        const VkIndexType vkIndexType = indexType == IndexType::UINT32 ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+        const VkDeviceSize vkOffset = buffer->offset + offset;
+
+        CommandBufferState &state = commandBuffer->state;
+        if (state.indexBuffer == buffer->buffer && state.indexOffset == vkOffset && state.indexType == vkIndexType)
+        {
+            commandBuffer->stats.filteredCalls++;
+            return;
+        }
+
+        state.indexBuffer = buffer->buffer;
+        state.indexOffset = vkOffset;
+        state.indexType = vkIndexType;
+        vkCmdBindIndexBuffer(commandBuffer->commandBuffer, buffer->buffer, vkOffset, vkIndexType);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdDraw(CommandBufferHandle commandBuffer, unsigned int vertexCount, unsigned int instanceCount,
+                 unsigned int firstVertex, unsigned int firstInstance)
+    {
+        assert(IsHandleAlive(commandBuffer));
+
+        vkCmdDraw(commandBuffer->commandBuffer, vertexCount, instanceCount, firstVertex, firstInstance);
+        commandBuffer->stats.issuedCalls++;
+        commandBuffer->stats.drawCalls++;
+    }
+
+    void CmdDrawIndexed(CommandBufferHandle commandBuffer, unsigned int indexCount, unsigned int instanceCount,
+                        unsigned int firstIndex, int vertexOffset, unsigned int firstInstance)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->state.indexBuffer != VK_NULL_HANDLE && "no index buffer bound");
+
+        vkCmdDrawIndexed(commandBuffer->commandBuffer, indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
+        commandBuffer->stats.issuedCalls++;
+        commandBuffer->stats.drawCalls++;
+    }
+
+    void CmdDrawIndirect(CommandBufferHandle commandBuffer, BufferHandle buffer, unsigned int offset,
+                         unsigned int drawCount, unsigned int stride)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(buffer));
+        assert(offset % 4 == 0 && (drawCount <= 1 || commandBuffer->device->capabilities.multiDrawIndirect));
+
+        vkCmdDrawIndirect(commandBuffer->commandBuffer, buffer->buffer, buffer->offset + offset, drawCount, stride);
+        commandBuffer->stats.issuedCalls++;
+        commandBuffer->stats.drawCalls++;
+    }
+
+    void CmdDrawIndexedIndirect(CommandBufferHandle commandBuffer, BufferHandle buffer, unsigned int offset,
+                                unsigned int drawCount, unsigned int stride)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(buffer));
+        assert(offset % 4 == 0 && (drawCount <= 1 || commandBuffer->device->capabilities.multiDrawIndirect));
+        assert(commandBuffer->state.indexBuffer != VK_NULL_HANDLE && "no index buffer bound");
+
+        vkCmdDrawIndexedIndirect(commandBuffer->commandBuffer, buffer->buffer, buffer->offset + offset, drawCount,
+                                 stride);
+        commandBuffer->stats.issuedCalls++;
+        commandBuffer->stats.drawCalls++;
+    }
+
+    void CmdSetCullMode(CommandBufferHandle commandBuffer, CullMode cullMode)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setCullMode);
+
+        commandBuffer->device->dynamicState.setCullMode(commandBuffer->commandBuffer, ConvertCullMode(cullMode));
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetFrontFace(CommandBufferHandle commandBuffer, FrontFace frontFace)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setFrontFace);
+
+        commandBuffer->device->dynamicState.setFrontFace(commandBuffer->commandBuffer, ConvertFrontFace(frontFace));
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetPrimitiveTopology(CommandBufferHandle commandBuffer, PrimitiveTopology topology)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setPrimitiveTopology);
+
+        commandBuffer->device->dynamicState.setPrimitiveTopology(commandBuffer->commandBuffer, ConvertPrimitiveTopology(topology));
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetDepthTestEnable(CommandBufferHandle commandBuffer, bool isEnabled)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setDepthTestEnable);
+
+        commandBuffer->device->dynamicState.setDepthTestEnable(commandBuffer->commandBuffer, isEnabled);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetDepthWriteEnable(CommandBufferHandle commandBuffer, bool isEnabled)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setDepthWriteEnable);
+
+        commandBuffer->device->dynamicState.setDepthWriteEnable(commandBuffer->commandBuffer, isEnabled);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetDepthCompareOp(CommandBufferHandle commandBuffer, CompareOp compareOp)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setDepthCompareOp);
+
+        commandBuffer->device->dynamicState.setDepthCompareOp(commandBuffer->commandBuffer, ConvertCompareOp(compareOp));
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdSetBlendEnable(CommandBufferHandle commandBuffer, bool isEnabled)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(commandBuffer->device->dynamicState.setColorBlendEnable);
+
+        const VkBool32 blendEnable = isEnabled;
+        commandBuffer->device->dynamicState.setColorBlendEnable(commandBuffer->commandBuffer, 0, 1, &blendEnable);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdBindDescriptorSets(CommandBufferHandle commandBuffer, PipelineHandle pipeline, unsigned int firstSet,
+                               const DescriptorSetHandle *sets, unsigned int setCount,
+                               const unsigned int *dynamicOffsets, unsigned int dynamicOffsetCount)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(pipeline));
+        assert(sets || setCount == 0);
+        assert(std::all_of(sets, sets + setCount, [](DescriptorSetHandle set) { return IsHandleAlive(set); }));
+        assert(dynamicOffsets || dynamicOffsetCount == 0);
+        assert(firstSet + setCount <= CommandBufferState::MAX_DESCRIPTOR_SETS);
+
+        CommandBufferState::BindPointState &bound = GetBindPointState(commandBuffer, pipeline->bindPoint);
+
+        // Sets bound with another pipeline layout may have been disturbed, only the same layout can be filtered
+        bool isRedundant = bound.setLayout == pipeline->pipelineLayout;
+        unsigned int offsetIndex = 0;
+        for (unsigned int i = 0; i < setCount && isRedundant; i++)
+        {
+            const CommandBufferState::BoundSet &boundSet = bound.sets[firstSet + i];
+            const uint32_t offsetCount = sets[i]->layout->dynamicDescriptorCount;
+
+            isRedundant = boundSet.set == sets[i]->set && boundSet.dynamicOffsetCount == offsetCount &&
+                          std::equal(dynamicOffsets + offsetIndex, dynamicOffsets + offsetIndex + offsetCount,
+                                     boundSet.dynamicOffsets.begin());
+            offsetIndex += offsetCount;
+        }
+
+        if (isRedundant)
+        {
+            commandBuffer->stats.filteredCalls++;
+            return;
+        }
+
+        if (bound.setLayout != pipeline->pipelineLayout)
+        {
+            bound.sets = {};
+            bound.setLayout = pipeline->pipelineLayout;
+        }
+
+        VkDescriptorSet descriptorSets[CommandBufferState::MAX_DESCRIPTOR_SETS];
+        offsetIndex = 0;
+        for (unsigned int i = 0; i < setCount; i++)
+        {
+            descriptorSets[i] = sets[i]->set;
+
+            CommandBufferState::BoundSet &boundSet = bound.sets[firstSet + i];
+            const uint32_t offsetCount = sets[i]->layout->dynamicDescriptorCount;
+            if (offsetCount <= CommandBufferState::MAX_DYNAMIC_OFFSETS)
+            {
+                boundSet.set = sets[i]->set;
+                boundSet.dynamicOffsetCount = offsetCount;
+                std::copy_n(dynamicOffsets + offsetIndex, offsetCount, boundSet.dynamicOffsets.begin());
+            } else
+            {
+                boundSet = {};
+            }
+            offsetIndex += offsetCount;
+        }
+        assert(offsetIndex == dynamicOffsetCount && "one dynamic offset per dynamic descriptor of the sets");
+
+        vkCmdBindDescriptorSets(commandBuffer->commandBuffer, pipeline->bindPoint, pipeline->pipelineLayout, firstSet,
+                                setCount, descriptorSets, dynamicOffsetCount, dynamicOffsets);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdPushConstants(CommandBufferHandle commandBuffer, PipelineHandle pipeline, unsigned int offset,
+                          unsigned int size, const void *data)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(pipeline));
+        assert(data && size > 0);
+
+        // Every stage reached must see all the bytes, so an overlapping range has to contain the whole write
+        VkShaderStageFlags stageFlags = 0;
+        for (const VkPushConstantRange &range : pipeline->key.layout.pushConstantRanges)
+        {
+            if (offset < range.offset + range.size && range.offset < offset + size)
+            {
+                assert(range.offset <= offset && offset + size <= range.offset + range.size &&
+                       "the write straddles the push constant range of a stage");
+                stageFlags |= range.stageFlags;
+            }
+        }
+        assert(stageFlags && "no push constant range of the pipeline covers these bytes");
+
+        vkCmdPushConstants(commandBuffer->commandBuffer, pipeline->pipelineLayout, stageFlags, offset, size, data);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdPushDescriptorSet(CommandBufferHandle commandBuffer, PipelineHandle pipeline, const DescriptorWrite *writes,
+                              unsigned int writeCount)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(pipeline));
+        assert(writes && writeCount > 0);
+        assert(commandBuffer->device->cmdPushDescriptorSet);
+        assert(pipeline->pushDescriptorLayout && "the pipeline was created without a push descriptor layout");
+
+        DescriptorWriteBatch batch;
+        BuildDescriptorWrites(commandBuffer->device, writes, writeCount, pipeline->pushDescriptorLayout, batch);
+
+        commandBuffer->device->cmdPushDescriptorSet(commandBuffer->commandBuffer, pipeline->bindPoint,
+                                                    pipeline->pipelineLayout, pipeline->pushDescriptorSet, writeCount,
+                                                    batch.writes.data());
+        commandBuffer->stats.issuedCalls++;
+
+        // Replaces whatever set was bound at that index, and may disturb sets bound with another layout
+        CommandBufferState::BindPointState &bound = GetBindPointState(commandBuffer, pipeline->bindPoint);
+        if (bound.setLayout != pipeline->pipelineLayout)
+        {
+            bound.sets = {};
+            bound.setLayout = pipeline->pipelineLayout;
+        }
+        assert(pipeline->pushDescriptorSet < CommandBufferState::MAX_DESCRIPTOR_SETS);
+        bound.sets[pipeline->pushDescriptorSet] = {};
+    }
+
+    void CmdDispatch(CommandBufferHandle commandBuffer, unsigned int groupCountX, unsigned int groupCountY,
+                     unsigned int groupCountZ)
+    {
+        assert(IsHandleAlive(commandBuffer));
+
+        vkCmdDispatch(commandBuffer->commandBuffer, groupCountX, groupCountY, groupCountZ);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    void CmdDispatchIndirect(CommandBufferHandle commandBuffer, BufferHandle buffer, unsigned int offset)
+    {
+        assert(IsHandleAlive(commandBuffer));
+        assert(IsHandleAlive(buffer));
+        assert(offset % 4 == 0 && offset + sizeof(VkDispatchIndirectCommand) <= buffer->size);
+
+        vkCmdDispatchIndirect(commandBuffer->commandBuffer, buffer->buffer, buffer->offset + offset);
+        commandBuffer->stats.issuedCalls++;
+    }
+
+    CommandBufferStats GetCommandBufferStats(CommandBufferHandle commandBuffer)
+    {
+        assert(IsHandleAlive(commandBuffer));
+
+        return commandBuffer->stats;
+    }
 }
@@ -1,6 +1,7 @@
 #include "vkrenderpass.h"
 #include "vkswapchain.h"
 #include "vkdevice.h"
+#include "vktexture.h"
 
 #include "utils.h"
 #include <swarm_internal.h>
@@ -16,28 +17,32 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(swapchain);
 
+        // Offscreen targets are kept for ReadTexture, depth included
+        const bool isOffscreen = swapchain == nullptr;
 
         VkAttachmentDescription colorAttachment{};
-        colorAttachment.format = swapchain->swapchain.image_format;
+        colorAttachment.format = isOffscreen ? ConvertTextureFormat(renderpassCreateInfo.colorFormat)
+                                             : swapchain->swapchain.image_format;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
         colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        colorAttachment.finalLayout = isOffscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentDescription depthAttachment{};
-        depthAttachment.format = FindDepthFormat(device->device.physical_device.physical_device);
+        depthAttachment.format = isOffscreen ? ConvertTextureFormat(renderpassCreateInfo.depthFormat)
+                                             : device->capabilityCache.depthFormat;
         depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
         depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.storeOp = isOffscreen ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.finalLayout = isOffscreen ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                                                  : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -63,6 +68,19 @@ namespace swarm
                                   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+        // Attachment writes have to land before a later copy out of the targets
+        VkSubpassDependency readbackDependency{};
+        readbackDependency.srcSubpass = 0;
+        readbackDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+        readbackDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                          VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        readbackDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        readbackDependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readbackDependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        std::array<VkSubpassDependency, 2> dependencies = {dependency, readbackDependency};
+
         std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -70,11 +88,11 @@ namespace swarm
         renderPassInfo.pAttachments = attachments.data();
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
+        renderPassInfo.dependencyCount = isOffscreen ? 2 : 1;
+        renderPassInfo.pDependencies = dependencies.data();
 
         VkRenderPass renderpass{VK_NULL_HANDLE};
-        if (vkCreateRenderPass(device->device, &renderPassInfo, nullptr, &renderpass) != VK_SUCCESS)
+        if (vkCreateRenderPass(device->device, &renderPassInfo, GetHostAllocator(), &renderpass) != VK_SUCCESS)
         {
             return nullptr;
         }
@@ -89,11 +107,16 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vkDestroyRenderPass(device->device, handle->renderPass, nullptr);
+        RenderpassHandle renderpass = handle;
+        RetireHandle(renderpass);
+        DestroyDeferred(device, [device, renderpass]()
+        {
+            vkDestroyRenderPass(device->device, renderpass->renderPass, GetHostAllocator());
 
-        SWARM_DELETE(handle);
+            SWARM_DELETE(renderpass);
+        });
     }
 
 
@@ -1,5 +1,7 @@
 #include "vksampler.h"
 #include "vkdevice.h"
+#include "vkdescriptorcache.h"
+#include "vkbindless.h"
 
 #include <cassert>
 namespace swarm
@@ -35,9 +37,6 @@ namespace swarm
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
 
-        VkPhysicalDeviceProperties properties{};
-        vkGetPhysicalDeviceProperties(device->device.physical_device, &properties);
-
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         samplerInfo.magFilter = ConvertFilter(createInfo.magFilter);
@@ -46,7 +45,7 @@ namespace swarm
         samplerInfo.addressModeV = ConvertAddressMode(createInfo.addressModeV);
         samplerInfo.addressModeW = ConvertAddressMode(createInfo.addressModeW);
         samplerInfo.anisotropyEnable = VK_FALSE;
-        samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
+        samplerInfo.maxAnisotropy = device->capabilityCache.properties.limits.maxSamplerAnisotropy;
         samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
         samplerInfo.unnormalizedCoordinates = VK_FALSE;
         samplerInfo.compareEnable = VK_FALSE;
@@ -54,12 +53,13 @@ namespace swarm
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 
         VkSampler sampler{VK_NULL_HANDLE};
-        if (vkCreateSampler(device->device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        if (vkCreateSampler(device->device, &samplerInfo, GetHostAllocator(), &sampler) != VK_SUCCESS) {
             return nullptr;
         }
 
         SamplerHandle handle = SWARM_NEW<Sampler_T>();
         handle->sampler = sampler;
+        handle->bindlessIndex = AddBindlessSampler(device, sampler);
         return handle;
     }
 
@@ -67,10 +67,17 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vkDestroySampler(device->device, handle->sampler, nullptr);
+        SamplerHandle sampler = handle;
+        RetireHandle(sampler);
+        EvictCachedDescriptorSets(device, sampler);
+        DestroyDeferred(device, [device, sampler]()
+        {
+            vkDestroySampler(device->device, sampler->sampler, GetHostAllocator());
+            ReleaseBindlessIndex(device, BINDLESS_SAMPLERS, sampler->bindlessIndex);
 
-        SWARM_DELETE(handle);
+            SWARM_DELETE(sampler);
+        });
     }
 }
\ No newline at end of file
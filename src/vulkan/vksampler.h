@@ -8,5 +8,6 @@ namespace swarm
     struct Sampler_T
     {
         VkSampler sampler;
+        uint32_t bindlessIndex{INVALID_BINDLESS_INDEX};
     };
 }
\ No newline at end of file
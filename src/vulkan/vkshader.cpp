@@ -38,7 +38,7 @@ namespace swarm
         createInfo.pCode = reinterpret_cast<unsigned int *>(buffer.data());
 
         VkShaderModule shader{VK_NULL_HANDLE};
-        if (vkCreateShaderModule(device->device, &createInfo, nullptr, &shader) != VK_SUCCESS)
+        if (vkCreateShaderModule(device->device, &createInfo, GetHostAllocator(), &shader) != VK_SUCCESS)
         {
             return nullptr;
         }
@@ -54,9 +54,9 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vkDestroyShaderModule(device->device, handle->module, nullptr);
+        vkDestroyShaderModule(device->device, handle->module, GetHostAllocator());
 
         SWARM_DELETE(handle);
     }
@@ -0,0 +1,121 @@
+#include "vkstaging.h"
+#include "vkdevice.h"
+
+#include <cassert>
+
+namespace swarm
+{
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    bool CreateStagingRing(Device_T *device, VkDeviceSize size, StagingRing &ring)
+    {
+        assert(device);
+
+        if (size == 0)
+            return true;
+
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+        VmaAllocationInfo allocationInfo{};
+        if (vmaCreateBuffer(device->allocator, &createInfo, &allocInfo, &ring.buffer, &ring.allocation, &allocationInfo) !=
+            VK_SUCCESS)
+        {
+            return false;
+        }
+
+        ring.mappedData = static_cast<unsigned char *>(allocationInfo.pMappedData);
+        ring.size = size;
+        ring.head = 0;
+        ring.tail = 0;
+
+        return true;
+    }
+
+    void DestroyStagingRing(Device_T *device, StagingRing &ring)
+    {
+        assert(device);
+
+        if (ring.buffer != VK_NULL_HANDLE)
+        {
+            vmaDestroyBuffer(device->allocator, ring.buffer, ring.allocation);
+        }
+
+        ring = {};
+    }
+
+    bool StagingRingFits(const StagingRing &ring, VkDeviceSize size, VkDeviceSize alignment)
+    {
+        // Leave room for the alignment padding, a request this big could never be satisfied
+        return size + alignment <= ring.size;
+    }
+
+    bool StagingRingTryAllocate(StagingRing &ring, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset)
+    {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+        const VkDeviceSize aligned = AlignUp(ring.head, alignment);
+
+        if (ring.head >= ring.tail)
+        {
+            if (aligned + size <= ring.size)
+            {
+                offset = aligned;
+                ring.head = aligned + size;
+                return true;
+            }
+
+            // Wrap around, the end of the ring is left unused until the tail moves past it
+            if (size < ring.tail)
+            {
+                offset = 0;
+                ring.head = size;
+                return true;
+            }
+        } else if (aligned + size < ring.tail)
+        {
+            offset = aligned;
+            ring.head = aligned + size;
+            return true;
+        }
+
+        return false;
+    }
+
+    void StagingRingSubmitted(StagingRing &ring, uint64_t serial)
+    {
+        if (!ring.inFlight.empty() && ring.inFlight.back().end == ring.head)
+            return;
+
+        StagingSpan span{};
+        span.end = ring.head;
+        span.serial = serial;
+        ring.inFlight.push_back(span);
+    }
+
+    void StagingRingRetire(StagingRing &ring, uint64_t completedSerial)
+    {
+        while (!ring.inFlight.empty() && ring.inFlight.front().serial <= completedSerial)
+        {
+            ring.tail = ring.inFlight.front().end;
+            ring.inFlight.pop_front();
+        }
+
+        // head == tail only ever means "nothing in use", allocations never let head catch up with tail
+        if (ring.head == ring.tail)
+        {
+            ring.head = 0;
+            ring.tail = 0;
+        }
+    }
+}
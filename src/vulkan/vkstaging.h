@@ -0,0 +1,45 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <deque>
+
+namespace swarm
+{
+    struct Device_T;
+
+    // Everything written in the ring before `end` is read by the upload batch `serial`
+    struct StagingSpan
+    {
+        VkDeviceSize end{0};
+        uint64_t serial{0};
+    };
+
+    // Persistently mapped upload buffer shared by every transfer of a device.
+    // Space is handed out linearly from `head` and given back at `tail` once the GPU is done with it.
+    struct StagingRing
+    {
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        unsigned char *mappedData{nullptr};
+
+        VkDeviceSize size{0};
+        VkDeviceSize head{0};
+        VkDeviceSize tail{0};
+
+        std::deque<StagingSpan> inFlight;
+    };
+
+    bool CreateStagingRing(Device_T *device, VkDeviceSize size, StagingRing &ring);
+    void DestroyStagingRing(Device_T *device, StagingRing &ring);
+
+    // Returns false when there is not enough free space right now, waiting on the oldest span is up to the caller
+    bool StagingRingTryAllocate(StagingRing &ring, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+    bool StagingRingFits(const StagingRing &ring, VkDeviceSize size, VkDeviceSize alignment);
+
+    // Closes the span of everything allocated since the previous submission
+    void StagingRingSubmitted(StagingRing &ring, uint64_t serial);
+    void StagingRingRetire(StagingRing &ring, uint64_t completedSerial);
+}
@@ -34,7 +34,7 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(instance != nullptr);
-        assert(handle != nullptr);
+        assert(IsHandleAlive(handle));
 
         vkb::destroy_surface(instance->instance, handle->surface);
 
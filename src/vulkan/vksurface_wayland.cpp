@@ -20,7 +20,7 @@ namespace swarm
         createInfo.display = static_cast<wl_display *>(surfaceCreateInfo.displayReference.waylandDisplay);
 
         VkSurfaceKHR surfaceHandle{VK_NULL_HANDLE};
-        if (vkCreateWaylandSurfaceKHR(instance->instance, &createInfo, nullptr, &surfaceHandle) != VK_SUCCESS)
+        if (vkCreateWaylandSurfaceKHR(instance->instance, &createInfo, GetHostAllocator(), &surfaceHandle) != VK_SUCCESS)
         {
             return nullptr;
         }
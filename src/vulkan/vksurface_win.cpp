@@ -18,7 +18,7 @@ namespace swarm
         createInfo.hwnd = static_cast<HWND>(surfaceCreateInfo.surfaceReference.win32Hwnd);
 
         VkSurfaceKHR surface{VK_NULL_HANDLE};
-        if (vkCreateWin32SurfaceKHR(instance->instance, &createInfo, nullptr, &surface) != VK_SUCCESS)
+        if (vkCreateWin32SurfaceKHR(instance->instance, &createInfo, GetHostAllocator(), &surface) != VK_SUCCESS)
         {
             return nullptr;
         }
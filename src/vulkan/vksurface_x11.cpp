@@ -17,7 +17,7 @@ namespace swarm
         createInfo.window = surfaceCreateInfo.surfaceReference.x11WindowId;
 
         VkSurfaceKHR surface{VK_NULL_HANDLE};
-        if (vkCreateXlibSurfaceKHR(instance->instance, &createInfo, nullptr, &surface) != VK_SUCCESS)
+        if (vkCreateXlibSurfaceKHR(instance->instance, &createInfo, GetHostAllocator(), &surface) != VK_SUCCESS)
         {
             return nullptr;
         }
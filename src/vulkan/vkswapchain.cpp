@@ -11,6 +11,7 @@ namespace swarm
 
         vkb::SwapchainBuilder swapchainBuilder{device->device};
         swapchainBuilder.set_desired_extent(900, 720);
+        swapchainBuilder.set_allocation_callbacks(GetHostAllocator());
 
         const auto swapchainResult = swapchainBuilder.build();
 
@@ -28,11 +29,11 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
         for (const auto& imageView : handle->imageViews)
         {
-            vkDestroyImageView(device->device, imageView, nullptr);
+            vkDestroyImageView(device->device, imageView, GetHostAllocator());
         }
 
         vkb::destroy_swapchain(handle->swapchain);
@@ -21,7 +21,7 @@ namespace swarm
         createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
         VkSemaphore semaphore{VK_NULL_HANDLE};
-        if (vkCreateSemaphore(device->device, &createInfo, nullptr, &semaphore) != VK_SUCCESS)
+        if (vkCreateSemaphore(device->device, &createInfo, GetHostAllocator(), &semaphore) != VK_SUCCESS)
         {
             return nullptr;
         }
@@ -42,7 +42,7 @@ namespace swarm
         createInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
         VkFence fence{VK_NULL_HANDLE};
-        if (vkCreateFence(device->device, &createInfo, nullptr, &fence) != VK_SUCCESS)
+        if (vkCreateFence(device->device, &createInfo, GetHostAllocator(), &fence) != VK_SUCCESS)
         {
             return nullptr;
         }
@@ -53,13 +53,88 @@ namespace swarm
         return handle;
     }
 
+    VkSemaphore CreateTimelineSemaphore(DeviceHandle device, uint64_t initialValue)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = initialValue;
+
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+
+        VkSemaphore semaphore{VK_NULL_HANDLE};
+        if (vkCreateSemaphore(device->device, &createInfo, GetHostAllocator(), &semaphore) != VK_SUCCESS)
+        {
+            return VK_NULL_HANDLE;
+        }
+
+        return semaphore;
+    }
+
+    TimelineHandle CreateTimeline(DeviceHandle device, uint64_t initialValue)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        VkSemaphore semaphore = CreateTimelineSemaphore(device, initialValue);
+        if (semaphore == VK_NULL_HANDLE)
+            return nullptr;
+
+        TimelineHandle handle = SWARM_NEW<Timeline_T>();
+        handle->semaphore = semaphore;
+
+        return handle;
+    }
+
+    uint64_t GetTimelineValue(DeviceHandle device, TimelineHandle timeline)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(timeline));
+
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(device->device, timeline->semaphore, &value);
+        return value;
+    }
+
+    bool WaitTimeline(DeviceHandle device, TimelineHandle timeline, uint64_t value, uint64_t timeout)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(timeline));
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline->semaphore;
+        waitInfo.pValues = &value;
+
+        return vkWaitSemaphores(device->device, &waitInfo, timeout) == VK_SUCCESS;
+    }
+
+    void SignalTimeline(DeviceHandle device, TimelineHandle timeline, uint64_t value)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(timeline));
+
+        VkSemaphoreSignalInfo signalInfo{};
+        signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+        signalInfo.semaphore = timeline->semaphore;
+        signalInfo.value = value;
+
+        vkSignalSemaphore(device->device, &signalInfo);
+    }
+
     void DestroySemaphore(DeviceHandle device, SemaphoreHandle &handle)
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vkDestroySemaphore(device->device, handle->semaphore, nullptr);
+        vkDestroySemaphore(device->device, handle->semaphore, GetHostAllocator());
 
         SWARM_DELETE(handle);
     }
@@ -68,9 +143,20 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
+
+        vkDestroyFence(device->device, handle->fence, GetHostAllocator());
+
+        SWARM_DELETE(handle);
+    }
+
+    void DestroyTimeline(DeviceHandle device, TimelineHandle &handle)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(handle));
 
-        vkDestroyFence(device->device, handle->fence, nullptr);
+        vkDestroySemaphore(device->device, handle->semaphore, GetHostAllocator());
 
         SWARM_DELETE(handle);
     }
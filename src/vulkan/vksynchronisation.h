@@ -13,4 +13,11 @@ namespace swarm
     {
         VkSemaphore semaphore;
     };
+
+    struct Timeline_T
+    {
+        VkSemaphore semaphore;
+    };
+
+    VkSemaphore CreateTimelineSemaphore(DeviceHandle device, uint64_t initialValue);
 }
\ No newline at end of file
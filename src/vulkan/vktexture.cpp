@@ -1,6 +1,8 @@
 #include "vktexture.h"
 #include "vkdevice.h"
 #include "utils.h"
+#include "vkdescriptorcache.h"
+#include "vkbindless.h"
 
 #include <cassert>
 
@@ -63,6 +65,39 @@ namespace swarm
         }
     }
 
+    static VkFormatFeatureFlags GetRequiredFormatFeatures(TextureUsageFlags usage)
+    {
+        VkFormatFeatureFlags features = 0;
+
+        if (static_cast<uint32_t>(usage & TextureUsageFlags::TRANSFER_SRC))
+            features |= VK_FORMAT_FEATURE_TRANSFER_SRC_BIT;
+        if (static_cast<uint32_t>(usage & TextureUsageFlags::TRANSFER_DST))
+            features |= VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+        if (static_cast<uint32_t>(usage & TextureUsageFlags::SAMPLED))
+            features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+        if (static_cast<uint32_t>(usage & TextureUsageFlags::COLOR_ATTACHMENT))
+            features |= VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT;
+        if (static_cast<uint32_t>(usage & TextureUsageFlags::DEPTH_STENCIL_ATTACHMENT))
+            features |= VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+        return features;
+    }
+
+    bool IsTextureFormatSupported(DeviceHandle device, TextureFormat format, TextureUsageFlags usage)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        VkFormat vkFormat = ConvertTextureFormat(format);
+        if (vkFormat == VK_FORMAT_UNDEFINED)
+            return false;
+
+        VkFormatFeatureFlags required = GetRequiredFormatFeatures(usage);
+        VkFormatFeatureFlags supported = GetFormatProperties(device->capabilityCache, vkFormat).optimalTilingFeatures;
+
+        return (supported & required) == required;
+    }
+
     TextureHandle CreateTexture(DeviceHandle device, const TextureCreateInfo &createInfo)
     {
         assert(g_SwarmLibrary.isInitialized);
@@ -81,7 +116,7 @@ namespace swarm
         imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
         imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
         imageInfo.usage = ConvertTextureUsage(createInfo.usage);
-        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        SetQueueSharing(device, imageInfo);
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
         imageInfo.flags = (createInfo.type == TextureType::TEXTURE_CUBE) ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
 
@@ -113,7 +148,7 @@ namespace swarm
         viewInfo.subresourceRange.layerCount = (createInfo.type == TextureType::TEXTURE_CUBE) ? 6 : 1;
 
         VkImageView imageView{VK_NULL_HANDLE};
-        if (vkCreateImageView(device->device, &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+        if (vkCreateImageView(device->device, &viewInfo, GetHostAllocator(), &imageView) != VK_SUCCESS)
         {
             vmaDestroyImage(device->allocator, image, imageAllocation);
             return nullptr;
@@ -124,6 +159,15 @@ namespace swarm
         handle->image = image;
         handle->imageView = imageView;
         handle->imageAllocation = imageAllocation;
+        handle->format = imageInfo.format;
+        handle->aspect = viewInfo.subresourceRange.aspectMask;
+        handle->extent = {createInfo.width, createInfo.height};
+        handle->mipLevels = createInfo.mipLevels;
+        handle->layerCount = imageInfo.arrayLayers;
+        handle->createdSubmission = device->submissionValue;
+        handle->createdComputeSubmission = device->computeSubmissionValue;
+        if (imageInfo.usage & VK_IMAGE_USAGE_SAMPLED_BIT)
+            handle->bindlessIndex = AddBindlessTexture(device, handle);
         return handle;
     }
 
@@ -131,11 +175,18 @@ namespace swarm
     {
         assert(g_SwarmLibrary.isInitialized);
         assert(device);
-        assert(handle);
+        assert(IsHandleAlive(handle));
 
-        vmaDestroyImage(device->allocator, handle->image, handle->imageAllocation);
-        vkDestroyImageView(device->device, handle->imageView, nullptr);
+        TextureHandle texture = handle;
+        RetireHandle(texture);
+        EvictCachedDescriptorSets(device, texture);
+        DestroyDeferred(device, [device, texture]()
+        {
+            vkDestroyImageView(device->device, texture->imageView, GetHostAllocator());
+            vmaDestroyImage(device->allocator, texture->image, texture->imageAllocation);
+            ReleaseBindlessIndex(device, BINDLESS_TEXTURES, texture->bindlessIndex);
 
-        SWARM_DELETE(handle);
+            SWARM_DELETE(texture);
+        });
     }
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <swarm/swarm.h>
+
 #include <vulkan/vulkan.h>
 #include <vk_mem_alloc.h>
 namespace swarm
@@ -9,5 +11,17 @@ namespace swarm
         VkImage image;
         VkImageView imageView;
         VmaAllocation imageAllocation;
+
+        VkFormat format{VK_FORMAT_UNDEFINED};
+        VkImageAspectFlags aspect{VK_IMAGE_ASPECT_COLOR_BIT};
+        VkExtent2D extent{};
+        unsigned int mipLevels{1};
+        unsigned int layerCount{1};
+
+        uint64_t createdSubmission{0}; //Device submission value at creation, no earlier submission can use the texture
+        uint64_t createdComputeSubmission{0}; //Same for the async compute queue
+        uint32_t bindlessIndex{INVALID_BINDLESS_INDEX}; //SAMPLED textures only, see GetBindlessIndex
     };
+
+    VkFormat ConvertTextureFormat(TextureFormat format);
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+#include "vktransientallocator.h"
+#include "vkbuffer.h"
+#include "vkdevice.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace swarm
+{
+    static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    TransientAllocatorHandle CreateTransientAllocator(DeviceHandle device, const TransientAllocatorCreateInfo &createInfo)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(createInfo.sizePerFrame > 0);
+        assert(createInfo.frameCount > 0);
+
+        const VkPhysicalDeviceLimits &limits = device->capabilityCache.properties.limits;
+
+        VkDeviceSize alignment = 16;
+        if ((createInfo.usage & BufferUsageFlags::UNIFORM) != BufferUsageFlags::NONE)
+            alignment = std::max(alignment, limits.minUniformBufferOffsetAlignment);
+        if ((createInfo.usage & BufferUsageFlags::STORAGE) != BufferUsageFlags::NONE)
+            alignment = std::max(alignment, limits.minStorageBufferOffsetAlignment);
+
+        // Every frame region starts aligned so that offsets handed out stay valid dynamic offsets
+        const VkDeviceSize sizePerFrame = AlignUp(createInfo.sizePerFrame, alignment);
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = sizePerFrame * createInfo.frameCount;
+        bufferInfo.usage = TranslateUsageFlags(createInfo.usage);
+        SetQueueSharing(device, bufferInfo);
+
+        // Coherent memory, allocations are written straight from the CPU with no flush before submission
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VmaAllocation allocation{VK_NULL_HANDLE};
+        VmaAllocationInfo allocationInfo{};
+        if (vmaCreateBuffer(device->allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo) !=
+            VK_SUCCESS)
+        {
+            return nullptr;
+        }
+
+        BufferHandle bufferHandle = SWARM_NEW<Buffer_T>();
+        bufferHandle->buffer = buffer;
+        bufferHandle->allocation = allocation;
+        bufferHandle->mappedData = allocationInfo.pMappedData;
+        bufferHandle->size = bufferInfo.size;
+        bufferHandle->usage = bufferInfo.usage;
+
+        TransientAllocatorHandle handle = SWARM_NEW<TransientAllocator_T>();
+        handle->buffer = bufferHandle;
+        handle->mappedData = static_cast<unsigned char *>(allocationInfo.pMappedData);
+        handle->alignment = alignment;
+        handle->sizePerFrame = sizePerFrame;
+        handle->frameCount = createInfo.frameCount;
+        handle->frameIndex = 0;
+        handle->head = 0;
+
+        return handle;
+    }
+
+    void DestroyTransientAllocator(DeviceHandle device, TransientAllocatorHandle &handle)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(handle));
+
+        DestroyBuffer(device, handle->buffer);
+
+        SWARM_DELETE(handle);
+        handle = nullptr;
+    }
+
+    bool TransientAllocate(TransientAllocatorHandle allocator, unsigned int size, TransientAllocation &allocation)
+    {
+        assert(IsHandleAlive(allocator));
+        assert(size > 0);
+
+        const VkDeviceSize frameEnd = (allocator->frameIndex + 1) * allocator->sizePerFrame;
+        const VkDeviceSize offset = AlignUp(allocator->head, allocator->alignment);
+        if (offset + size > frameEnd)
+            return false;
+
+        allocator->head = offset + size;
+
+        allocation.buffer = allocator->buffer;
+        allocation.offset = static_cast<unsigned int>(offset);
+        allocation.size = size;
+        allocation.data = allocator->mappedData + offset;
+        return true;
+    }
+
+    void TransientAllocatorNextFrame(TransientAllocatorHandle allocator)
+    {
+        assert(IsHandleAlive(allocator));
+
+        allocator->frameIndex = (allocator->frameIndex + 1) % allocator->frameCount;
+        allocator->head = allocator->frameIndex * allocator->sizePerFrame;
+    }
+}
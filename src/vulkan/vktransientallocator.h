@@ -0,0 +1,22 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+namespace swarm
+{
+    struct TransientAllocator_T
+    {
+        BufferHandle buffer{nullptr};
+        unsigned char *mappedData{nullptr};
+
+        VkDeviceSize alignment{1};
+        VkDeviceSize sizePerFrame{0};
+        unsigned int frameCount{1};
+
+        unsigned int frameIndex{0};
+        VkDeviceSize head{0};
+    };
+
+    // Moves to the region of the next frame, only safe once the fence of the frame that last used it has signaled
+    void TransientAllocatorNextFrame(TransientAllocatorHandle allocator);
+}
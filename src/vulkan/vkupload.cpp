@@ -0,0 +1,610 @@
+#include "vkupload.h"
+#include "vkdevice.h"
+#include "vkbuffer.h"
+#include "vktexture.h"
+#include "vksynchronisation.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace swarm
+{
+    static void ReleaseBatch(Device_T *device, UploadContext &context, UploadBatch &batch)
+    {
+        for (const UploadScratchBuffer &scratch: batch.scratchBuffers)
+        {
+            vmaDestroyBuffer(device->allocator, scratch.buffer, scratch.allocation);
+        }
+        batch.scratchBuffers.clear();
+
+        if (batch.commandBuffer != VK_NULL_HANDLE)
+        {
+            vkResetCommandBuffer(batch.commandBuffer, 0);
+            context.freeCommandBuffers.push_back(batch.commandBuffer);
+            batch.commandBuffer = VK_NULL_HANDLE;
+        }
+    }
+
+    static void WaitTimelineValue(Device_T *device, VkSemaphore timeline, uint64_t value)
+    {
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timeline;
+        waitInfo.pValues = &value;
+        vkWaitSemaphores(device->device, &waitInfo, UINT64_MAX);
+    }
+
+    bool CreateUploadContext(Device_T *device, UploadContext &context)
+    {
+        assert(device);
+
+        VkCommandPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        createInfo.queueFamilyIndex = device->uploadQueueFamily;
+
+        if (vkCreateCommandPool(device->device, &createInfo, GetHostAllocator(), &context.commandPool) != VK_SUCCESS)
+            return false;
+
+        context.timeline = CreateTimelineSemaphore(device, 0);
+        return context.timeline != VK_NULL_HANDLE;
+    }
+
+    void DestroyUploadContext(Device_T *device, UploadContext &context)
+    {
+        assert(device);
+
+        if (context.timeline != VK_NULL_HANDLE)
+        {
+            WaitTimelineValue(device, context.timeline, context.submittedSerial);
+            vkDestroySemaphore(device->device, context.timeline, GetHostAllocator());
+        }
+
+        for (UploadBatch &batch: context.inFlight)
+        {
+            ReleaseBatch(device, context, batch);
+        }
+        context.inFlight.clear();
+        ReleaseBatch(device, context, context.recording);
+
+        // Freed along with the pool
+        if (context.commandPool != VK_NULL_HANDLE)
+        {
+            vkDestroyCommandPool(device->device, context.commandPool, GetHostAllocator());
+        }
+
+        context = {};
+    }
+
+    void UploadPoll(Device_T *device)
+    {
+        UploadContext &context = device->uploadContext;
+
+        if (context.inFlight.empty())
+            return;
+
+        uint64_t completedSerial = 0;
+        vkGetSemaphoreCounterValue(device->device, context.timeline, &completedSerial);
+        context.completedSerial = completedSerial;
+
+        while (!context.inFlight.empty() && context.inFlight.front().serial <= completedSerial)
+        {
+            ReleaseBatch(device, context, context.inFlight.front());
+            context.inFlight.pop_front();
+        }
+
+        StagingRingRetire(device->stagingRing, context.completedSerial);
+    }
+
+    bool UploadAllocateStaging(Device_T *device, VkDeviceSize size, VkDeviceSize alignment, VkBuffer &buffer,
+                               VkDeviceSize &offset, void *&mappedData)
+    {
+        UploadContext &context = device->uploadContext;
+        StagingRing &ring = device->stagingRing;
+
+        if (StagingRingFits(ring, size, alignment))
+        {
+            UploadPoll(device);
+            while (!StagingRingTryAllocate(ring, size, alignment, offset))
+            {
+                // Everything in use belongs to the open batch, it has to go before anything can be recycled
+                if (ring.inFlight.empty())
+                    FlushUploads(device);
+
+                WaitUpload(device, ring.inFlight.front().serial);
+            }
+
+            buffer = ring.buffer;
+            mappedData = ring.mappedData + offset;
+            return true;
+        }
+
+        // Too big for the ring, use a scratch staging buffer living as long as the batch
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = size;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+        UploadScratchBuffer scratch{};
+        VmaAllocationInfo allocationInfo{};
+        if (vmaCreateBuffer(device->allocator, &createInfo, &allocInfo, &scratch.buffer, &scratch.allocation,
+                            &allocationInfo) != VK_SUCCESS)
+        {
+            return false;
+        }
+
+        context.recording.scratchBuffers.push_back(scratch);
+        buffer = scratch.buffer;
+        offset = 0;
+        mappedData = allocationInfo.pMappedData;
+        return true;
+    }
+
+    VkCommandBuffer UploadBeginRecording(Device_T *device, VkBuffer destination, VkDeviceSize offset, VkDeviceSize size)
+    {
+        UploadContext &context = device->uploadContext;
+        UploadBatch &batch = context.recording;
+
+        if (batch.commandBuffer == VK_NULL_HANDLE)
+        {
+            VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+            if (!context.freeCommandBuffers.empty())
+            {
+                commandBuffer = context.freeCommandBuffers.back();
+                context.freeCommandBuffers.pop_back();
+            } else
+            {
+                VkCommandBufferAllocateInfo allocInfo{};
+                allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                allocInfo.commandPool = context.commandPool;
+                allocInfo.commandBufferCount = 1;
+
+                if (vkAllocateCommandBuffers(device->device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+                {
+                    throw std::runtime_error("failed to allocate upload command buffer!");
+                }
+            }
+
+            // DestroyDeferred reads both from pipeline workers
+            {
+                std::lock_guard lock(device->releaseMutex);
+                batch.commandBuffer = commandBuffer;
+                batch.serial = context.submittedSerial + 1;
+            }
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
+
+            // Don't overwrite anything earlier submissions on the queue may still be reading
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        if (destination != VK_NULL_HANDLE)
+        {
+            auto &destinations = context.recordedDestinations;
+            const bool overlaps = std::any_of(destinations.begin(), destinations.end(), [&](const UploadDestination &other)
+            {
+                return other.buffer == destination && offset < other.end && other.begin < offset + size;
+            });
+
+            if (overlaps)
+            {
+                // Copies within a command buffer may run in any order, keep overlapping writes ordered
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     0, 1, &barrier, 0, nullptr, 0, nullptr);
+                destinations.clear();
+            }
+
+            UploadDestination written{};
+            written.buffer = destination;
+            written.begin = offset;
+            written.end = offset + size;
+            destinations.push_back(written);
+        }
+
+        return batch.commandBuffer;
+    }
+
+    void UploadDependOnDevice(Device_T *device, uint64_t createdSubmission, uint64_t createdComputeSubmission)
+    {
+        UploadBatch &batch = device->uploadContext.recording;
+        assert(batch.commandBuffer != VK_NULL_HANDLE);
+
+        if (HasSeparateUploadQueue(device) && device->submissionValue > createdSubmission)
+            batch.graphicsWaitValue = device->submissionValue;
+
+        // Async compute runs on its own queue even when uploads share the graphics one
+        if (device->computeQueue != VK_NULL_HANDLE && device->computeQueue != device->uploadQueue &&
+            device->computeSubmissionValue > createdComputeSubmission)
+            batch.computeWaitValue = device->computeSubmissionValue;
+    }
+
+    UploadToken EnqueueBufferUpload(DeviceHandle device, BufferHandle dstBuffer, const void *data, unsigned int size,
+                                    unsigned int dstOffset)
+    {
+        BufferUpdateRange range{};
+        range.offset = 0;
+        range.size = size;
+        range.data = data;
+        return EnqueueBufferUpdateRange(device, dstBuffer, dstOffset, &range, 1);
+    }
+
+    UploadToken EnqueueBufferUpdateRange(DeviceHandle device, BufferHandle dstBuffer, unsigned int dstOffset,
+                                         const BufferUpdateRange *ranges, unsigned int rangeCount)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(dstBuffer));
+        assert(ranges && rangeCount > 0);
+
+        if (dstBuffer->mappedData)
+        {
+            auto *mappedData = static_cast<unsigned char *>(dstBuffer->mappedData) + dstOffset;
+            for (unsigned int i = 0; i < rangeCount; i++)
+            {
+                assert(ranges[i].data && dstOffset + ranges[i].offset + ranges[i].size <= dstBuffer->size);
+                memcpy(mappedData + ranges[i].offset, ranges[i].data, ranges[i].size);
+                vmaFlushAllocation(device->allocator, dstBuffer->allocation, dstOffset + ranges[i].offset, ranges[i].size);
+            }
+            return 0; // Nothing for the GPU to do, already complete
+        }
+
+        // Pack the ranges in destination order so that neighbours end up next to each other in staging memory too
+        std::vector<unsigned int> order(rangeCount);
+        VkDeviceSize stagingSize = 0;
+        for (unsigned int i = 0; i < rangeCount; i++)
+        {
+            assert(ranges[i].data && ranges[i].size > 0);
+            assert(dstOffset + ranges[i].offset + ranges[i].size <= dstBuffer->size);
+            order[i] = i;
+            stagingSize += ranges[i].size;
+        }
+        std::sort(order.begin(), order.end(), [ranges](unsigned int a, unsigned int b)
+        {
+            return ranges[a].offset < ranges[b].offset;
+        });
+
+        VkBuffer stagingBuffer{VK_NULL_HANDLE};
+        VkDeviceSize stagingOffset = 0;
+        void *stagingData = nullptr;
+        if (!UploadAllocateStaging(device, stagingSize, 4, stagingBuffer, stagingOffset, stagingData))
+        {
+            throw std::runtime_error("failed to allocate upload staging memory!");
+        }
+
+        const VkDeviceSize baseOffset = dstBuffer->offset + dstOffset;
+        std::vector<VkBufferCopy> copyRegions;
+        copyRegions.reserve(rangeCount);
+
+        auto *staging = static_cast<unsigned char *>(stagingData);
+        VkDeviceSize packedOffset = 0;
+        for (unsigned int index: order)
+        {
+            const BufferUpdateRange &range = ranges[index];
+            memcpy(staging + packedOffset, range.data, range.size);
+
+            // Regions of a single copy must not overlap
+            assert(copyRegions.empty() ||
+                   copyRegions.back().dstOffset + copyRegions.back().size <= baseOffset + range.offset);
+
+            if (!copyRegions.empty() && copyRegions.back().dstOffset + copyRegions.back().size == baseOffset + range.offset)
+            {
+                copyRegions.back().size += range.size;
+            } else
+            {
+                VkBufferCopy copyRegion{};
+                copyRegion.srcOffset = stagingOffset + packedOffset;
+                copyRegion.dstOffset = baseOffset + range.offset;
+                copyRegion.size = range.size;
+                copyRegions.push_back(copyRegion);
+            }
+
+            packedOffset += range.size;
+        }
+
+        const VkDeviceSize firstByte = copyRegions.front().dstOffset;
+        const VkDeviceSize lastByte = copyRegions.back().dstOffset + copyRegions.back().size;
+        VkCommandBuffer commandBuffer = UploadBeginRecording(device, dstBuffer->buffer, firstByte, lastByte - firstByte);
+        UploadDependOnDevice(device, dstBuffer->createdSubmission, dstBuffer->createdComputeSubmission);
+
+        vkCmdCopyBuffer(commandBuffer, stagingBuffer, dstBuffer->buffer, static_cast<uint32_t>(copyRegions.size()),
+                        copyRegions.data());
+
+        return device->uploadContext.recording.serial;
+    }
+
+    UploadToken EnqueueBufferCopy(DeviceHandle device, BufferHandle srcBuffer, BufferHandle dstBuffer, unsigned int size,
+                                  unsigned int srcOffset, unsigned int dstOffset)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(srcBuffer));
+        assert(IsHandleAlive(dstBuffer));
+        assert(size > 0 && srcOffset + size <= srcBuffer->size && dstOffset + size <= dstBuffer->size);
+
+        VkCommandBuffer commandBuffer = UploadBeginRecording(device, dstBuffer->buffer, dstBuffer->offset + dstOffset, size);
+        UploadDependOnDevice(device, std::min(srcBuffer->createdSubmission, dstBuffer->createdSubmission),
+                             std::min(srcBuffer->createdComputeSubmission, dstBuffer->createdComputeSubmission));
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = srcBuffer->offset + srcOffset;
+        copyRegion.dstOffset = dstBuffer->offset + dstOffset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(commandBuffer, srcBuffer->buffer, dstBuffer->buffer, 1, &copyRegion);
+
+        return device->uploadContext.recording.serial;
+    }
+
+    static unsigned int GetTexelSize(VkFormat format)
+    {
+        switch (format)
+        {
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+                return 8;
+            default:
+                return 4;
+        }
+    }
+
+    UploadToken EnqueueTextureUpload(DeviceHandle device, TextureHandle texture, const void *data, unsigned int size)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(texture));
+        assert(data);
+
+        // Every mip level is copied so none is sampled undefined, each one reads its whole extent from staging
+        std::vector<VkBufferImageCopy> regions(texture->mipLevels);
+        VkDeviceSize textureSize = 0;
+        for (unsigned int mip = 0; mip < texture->mipLevels; mip++)
+        {
+            const uint32_t width = std::max(texture->extent.width >> mip, 1u);
+            const uint32_t height = std::max(texture->extent.height >> mip, 1u);
+
+            VkBufferImageCopy &region = regions[mip];
+            region.bufferOffset = textureSize;
+            region.imageSubresource.aspectMask = texture->aspect;
+            region.imageSubresource.mipLevel = mip;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = texture->layerCount;
+            region.imageExtent = {width, height, 1};
+
+            textureSize += static_cast<VkDeviceSize>(width) * height * texture->layerCount *
+                           GetTexelSize(texture->format);
+        }
+        assert(size >= textureSize && "data must hold every mip level of every layer");
+
+        VkBuffer stagingBuffer{VK_NULL_HANDLE};
+        VkDeviceSize stagingOffset = 0;
+        void *stagingData = nullptr;
+        if (!UploadAllocateStaging(device, size, 16, stagingBuffer, stagingOffset, stagingData))
+        {
+            throw std::runtime_error("failed to allocate upload staging memory!");
+        }
+
+        memcpy(stagingData, data, size);
+
+        VkCommandBuffer commandBuffer = UploadBeginRecording(device, VK_NULL_HANDLE, 0, 0);
+        UploadDependOnDevice(device, texture->createdSubmission, texture->createdComputeSubmission);
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = texture->image;
+        barrier.subresourceRange.aspectMask = texture->aspect;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = texture->mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = texture->layerCount;
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        for (VkBufferImageCopy &region : regions)
+            region.bufferOffset += stagingOffset;
+        vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(regions.size()), regions.data());
+
+        // A transfer queue can't name shader access, the graphics side then gets visibility from the timeline wait
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = HasSeparateUploadQueue(device) ? 0 : VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        return device->uploadContext.recording.serial;
+    }
+
+    UploadToken FlushUploads(DeviceHandle device)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        UploadContext &context = device->uploadContext;
+        UploadBatch &batch = context.recording;
+
+        if (batch.commandBuffer == VK_NULL_HANDLE)
+            return context.submittedSerial;
+
+        // Make the copies visible to everything submitted after them on the queue
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        vkEndCommandBuffer(batch.commandBuffer);
+
+        // The ring is written sequentially, one flush for the whole batch is enough
+        if (device->stagingRing.allocation != VK_NULL_HANDLE)
+            vmaFlushAllocation(device->allocator, device->stagingRing.allocation, 0, VK_WHOLE_SIZE);
+        for (const UploadScratchBuffer &scratch: batch.scratchBuffers)
+        {
+            vmaFlushAllocation(device->allocator, scratch.allocation, 0, VK_WHOLE_SIZE);
+        }
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.signalSemaphoreValueCount = 1;
+        timelineInfo.pSignalSemaphoreValues = &batch.serial;
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = &timelineInfo;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &batch.commandBuffer;
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &context.timeline;
+
+        std::array<VkSemaphore, 2> waitSemaphores{};
+        std::array<uint64_t, 2> waitValues{};
+        uint32_t waitCount = 0;
+        if (batch.graphicsWaitValue > 0)
+        {
+            waitSemaphores[waitCount] = device->submissionTimeline;
+            waitValues[waitCount++] = batch.graphicsWaitValue;
+        }
+        if (batch.computeWaitValue > 0)
+        {
+            waitSemaphores[waitCount] = device->computeTimeline;
+            waitValues[waitCount++] = batch.computeWaitValue;
+        }
+
+        const std::array<VkPipelineStageFlags, 2> waitStages = {VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                                VK_PIPELINE_STAGE_TRANSFER_BIT};
+        timelineInfo.waitSemaphoreValueCount = waitCount;
+        timelineInfo.pWaitSemaphoreValues = waitValues.data();
+        submitInfo.waitSemaphoreCount = waitCount;
+        submitInfo.pWaitSemaphores = waitSemaphores.data();
+        submitInfo.pWaitDstStageMask = waitStages.data();
+
+        if (vkQueueSubmit(device->uploadQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+        {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        StagingRingSubmitted(device->stagingRing, batch.serial);
+        {
+            std::lock_guard lock(device->releaseMutex);
+            context.submittedSerial = batch.serial;
+            context.inFlight.push_back(std::move(batch));
+            context.recording = {};
+        }
+        context.recordedDestinations.clear();
+
+        return context.submittedSerial;
+    }
+
+    bool IsUploadComplete(DeviceHandle device, UploadToken token)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        if (token > device->uploadContext.completedSerial)
+            UploadPoll(device);
+
+        return token <= device->uploadContext.completedSerial;
+    }
+
+    void WaitUpload(DeviceHandle device, UploadToken token)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+
+        UploadContext &context = device->uploadContext;
+        if (token <= context.completedSerial)
+            return;
+
+        if (token > context.submittedSerial)
+            FlushUploads(device);
+
+        WaitTimelineValue(device, context.timeline, std::min(token, context.submittedSerial));
+        UploadPoll(device);
+    }
+
+    bool ReadTexture(DeviceHandle device, TextureHandle texture, void *data, unsigned int size)
+    {
+        assert(g_SwarmLibrary.isInitialized);
+        assert(device);
+        assert(IsHandleAlive(texture));
+        assert(data);
+
+        const VkDeviceSize readbackSize = static_cast<VkDeviceSize>(texture->extent.width) * texture->extent.height *
+                                          texture->layerCount * GetTexelSize(texture->format);
+        if (size < readbackSize)
+            return false;
+
+        VkBufferCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        createInfo.size = readbackSize;
+        createInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+
+        VkBuffer readbackBuffer{VK_NULL_HANDLE};
+        VmaAllocation readbackAllocation{VK_NULL_HANDLE};
+        VmaAllocationInfo allocationInfo{};
+        if (vmaCreateBuffer(device->allocator, &createInfo, &allocInfo, &readbackBuffer, &readbackAllocation,
+                            &allocationInfo) != VK_SUCCESS)
+        {
+            return false;
+        }
+
+        // The offscreen renderpass left the texture in TRANSFER_SRC layout, its subpass dependency orders the copy
+        VkCommandBuffer commandBuffer = UploadBeginRecording(device, VK_NULL_HANDLE, 0, 0);
+        UploadDependOnDevice(device, 0, 0);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource.aspectMask = texture->aspect;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = texture->layerCount;
+        region.imageExtent = {texture->extent.width, texture->extent.height, 1};
+        vkCmdCopyImageToBuffer(commandBuffer, texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer,
+                               1, &region);
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        WaitUpload(device, FlushUploads(device));
+
+        vmaInvalidateAllocation(device->allocator, readbackAllocation, 0, VK_WHOLE_SIZE);
+        memcpy(data, allocationInfo.pMappedData, readbackSize);
+
+        vmaDestroyBuffer(device->allocator, readbackBuffer, readbackAllocation);
+        return true;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <swarm_internal.h>
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <deque>
+#include <vector>
+
+namespace swarm
+{
+    struct Device_T;
+
+    // Staging memory for an upload too big for the ring, released with the batch reading from it
+    struct UploadScratchBuffer
+    {
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VmaAllocation allocation{VK_NULL_HANDLE};
+    };
+
+    // Range of a buffer written by the open batch
+    struct UploadDestination
+    {
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkDeviceSize begin{0};
+        VkDeviceSize end{0};
+    };
+
+    struct UploadBatch
+    {
+        uint64_t serial{0};
+        VkCommandBuffer commandBuffer{VK_NULL_HANDLE};
+        uint64_t graphicsWaitValue{0}; //Device submission the batch waits for on a separate upload queue
+        uint64_t computeWaitValue{0}; //Same for the async compute queue
+        std::vector<UploadScratchBuffer> scratchBuffers;
+    };
+
+    // Every transfer of a device is recorded in the open batch and reaches the queue in one submission on flush.
+    // Batch serials are the public upload tokens, they grow by one per flush and are signaled on `timeline`.
+    struct UploadContext
+    {
+        VkCommandPool commandPool{VK_NULL_HANDLE};
+        VkSemaphore timeline{VK_NULL_HANDLE};
+
+        UploadBatch recording;
+        std::vector<UploadDestination> recordedDestinations;
+        std::deque<UploadBatch> inFlight;
+
+        std::vector<VkCommandBuffer> freeCommandBuffers;
+
+        uint64_t submittedSerial{0};
+        uint64_t completedSerial{0};
+    };
+
+    bool CreateUploadContext(Device_T *device, UploadContext &context);
+    void DestroyUploadContext(Device_T *device, UploadContext &context);
+
+    // Reserves host visible memory for `size` bytes, either in the staging ring or in a scratch buffer of the open batch.
+    // Must be called before UploadBeginRecording since running out of ring space flushes the open batch.
+    bool UploadAllocateStaging(Device_T *device, VkDeviceSize size, VkDeviceSize alignment, VkBuffer &buffer,
+                               VkDeviceSize &offset, void *&mappedData);
+
+    // Returns the command buffer of the open batch, orders the next write to the destination range after overlapping ones.
+    // Image uploads pass VK_NULL_HANDLE and take care of their own layout barriers.
+    VkCommandBuffer UploadBeginRecording(Device_T *device, VkBuffer destination, VkDeviceSize offset, VkDeviceSize size);
+
+    // Makes the open batch wait for the graphics and async compute submissions that may use a resource created when
+    // the submission values of those queues were `createdSubmission` and `createdComputeSubmission`, whenever they run
+    // on another queue than uploads. Fresh resources don't wait, so streaming overlaps rendering while updates of
+    // resources in use stay ordered after it.
+    void UploadDependOnDevice(Device_T *device, uint64_t createdSubmission, uint64_t createdComputeSubmission);
+
+    void UploadPoll(Device_T *device);
+}